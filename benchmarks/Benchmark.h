@@ -0,0 +1,213 @@
+/*
+ * Benchmark.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+/*
+ * Helpers shared by the benchmarks: wall time, cache misses, the thread
+ * counts to measure and the JSON report written to the standard output.
+ */
+
+#ifndef RVO_BENCHMARKS_BENCHMARK_H_
+#define RVO_BENCHMARKS_BENCHMARK_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+
+/* Returns the wall time in seconds since an arbitrary epoch. */
+inline double getWallTime()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*
+ * Counts the L1 data cache read misses and the last-level cache misses of the
+ * calling thread while started, with the Linux performance counters. The
+ * counters are unavailable on other systems and where the kernel or the
+ * virtual machine does not expose them.
+ */
+class CacheMissCounter {
+public:
+	enum Level { L1_DATA, LAST_LEVEL, NUM_LEVELS };
+
+	CacheMissCounter()
+	{
+#ifdef __linux__
+		const unsigned long long readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+		fds_[L1_DATA] = openCounter(PERF_COUNT_HW_CACHE_L1D | readMiss);
+		fds_[LAST_LEVEL] = openCounter(PERF_COUNT_HW_CACHE_LL | readMiss);
+#else
+		fds_[L1_DATA] = -1;
+		fds_[LAST_LEVEL] = -1;
+#endif
+	}
+
+	~CacheMissCounter()
+	{
+#ifdef __linux__
+		for (size_t i = 0; i < NUM_LEVELS; ++i) {
+			if (fds_[i] != -1) {
+				close(fds_[i]);
+			}
+		}
+#endif
+	}
+
+	/* Returns the misses counted at a cache level while started. */
+	unsigned long long getMisses(Level level) const
+	{
+		unsigned long long misses = 0;
+
+#ifdef __linux__
+		if (fds_[level] == -1 || read(fds_[level], &misses, sizeof(misses)) != sizeof(misses)) {
+			misses = 0;
+		}
+#endif
+
+		return misses;
+	}
+
+	/* Returns whether the misses of both cache levels are counted. */
+	bool isAvailable() const
+	{
+		return fds_[L1_DATA] != -1 && fds_[LAST_LEVEL] != -1;
+	}
+
+	/* Counts the misses from now on, adding to the misses counted before. */
+	void start()
+	{
+		enable(true);
+	}
+
+	/* Stops counting the misses. */
+	void stop()
+	{
+		enable(false);
+	}
+
+private:
+	CacheMissCounter(const CacheMissCounter &);
+	CacheMissCounter &operator=(const CacheMissCounter &);
+
+	void enable(bool enabled)
+	{
+#ifdef __linux__
+		for (size_t i = 0; i < NUM_LEVELS; ++i) {
+			if (fds_[i] != -1) {
+				ioctl(fds_[i], enabled ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+			}
+		}
+#else
+		(void)enabled;
+#endif
+	}
+
+#ifdef __linux__
+	/* Opens a disabled hardware cache counter of the calling thread. */
+	static int openCounter(unsigned long long config)
+	{
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HW_CACHE;
+		attr.config = config;
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+
+		return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+	}
+#endif
+
+	int fds_[NUM_LEVELS];
+};
+
+/*
+ * Returns the thread counts for the thread scaling measurements: the powers
+ * of two up to the number of hardware threads, and the number of hardware
+ * threads itself.
+ */
+inline std::vector<size_t> getThreadCounts(size_t maxThreads)
+{
+	if (maxThreads == 0) {
+		maxThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	std::vector<size_t> threadCounts;
+
+	for (size_t numThreads = 1; numThreads < maxThreads; numThreads *= 2) {
+		threadCounts.push_back(numThreads);
+	}
+
+	threadCounts.push_back(maxThreads);
+
+	return threadCounts;
+}
+
+/* Returns a result entry with the throughput of a number of steps. */
+inline json makeStepResult(size_t numAgentSteps, size_t numSteps, double seconds)
+{
+	json result;
+	result["steps"] = numSteps;
+	result["seconds"] = seconds;
+	result["stepsPerSecond"] = numSteps / seconds;
+	result["nsPerAgentStep"] = (numAgentSteps > 0 ? 1.0e9 * seconds / numAgentSteps : 0.0);
+
+	return result;
+}
+
+/* Writes a report with the machine description to the standard output. */
+inline void writeReport(const char *benchmark, const json &results)
+{
+	json report;
+	report["benchmark"] = benchmark;
+	report["hardwareThreads"] = std::thread::hardware_concurrency();
+	report["results"] = results;
+
+	std::cout << report.dump(2) << std::endl;
+}
+
+#endif /* RVO_BENCHMARKS_BENCHMARK_H_ */
@@ -0,0 +1,446 @@
+/*
+ * Kernels.cpp
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+/*
+ * Microbenchmarks of the kernels of the library: the two- and
+ * three-dimensional linear programs on ORCA lines recorded from a crowded
+ * scenario, the build and queries of the obstacle kd-tree on grids of blocks,
+ * the build and lookups of goal distance fields on the same grids, and the
+ * build and neighbor queries of the agent kd-tree.
+ *
+ * The agent kd-tree is internal to the simulator, so its kernels, like the
+ * node visits of obstacle neighbor queries, are measured through the step
+ * statistics and are only reported when the library is compiled with
+ * RVO_INSTRUMENTATION defined as 1.
+ *
+ * Usage: Kernels [number of agents] [number of repetitions]
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Agent.h"
+#include "Benchmark.h"
+#include "Scenarios.h"
+
+/* The ORCA lines of an agent, recorded after a simulation step. */
+struct LinearProgram {
+	std::vector<RVO::Line> lines;
+	float maxSpeed;
+	RVO::Vector2 prefVelocity;
+};
+
+/*
+ * Runs the Crossing scenario until the crowds meet and records the ORCA
+ * lines of the agents of the step with the most agents needing the
+ * three-dimensional linear program.
+ */
+void recordLinearPrograms(size_t numAgents, std::vector<LinearProgram> &programs)
+{
+	RVO::RVOSimulator *sim = new RVO::RVOSimulator();
+	std::vector<RVO::Vector2> goals;
+	unsigned int seed = 1;
+
+	setupScenario(sim, SCENARIO_CROSSING, numAgents, goals);
+	sim->setRecording(true);
+
+	size_t maxFallbacks = 0;
+
+	for (size_t step = 0; step < 400; ++step) {
+		setPreferredVelocities(sim, goals, seed);
+
+		const size_t numFallbacks = sim->getNumLinearProgram3Fallbacks();
+		sim->doStep();
+
+		if (programs.empty() || sim->getNumLinearProgram3Fallbacks() - numFallbacks > maxFallbacks) {
+			maxFallbacks = sim->getNumLinearProgram3Fallbacks() - numFallbacks;
+			programs.resize(sim->getNumAgents());
+
+			for (size_t i = 0; i < sim->getNumAgents(); ++i) {
+				programs[i].lines.resize(sim->getAgentNumORCALines(i));
+
+				for (size_t j = 0; j < programs[i].lines.size(); ++j) {
+					programs[i].lines[j] = sim->getAgentORCALine(i, j);
+				}
+
+				programs[i].maxSpeed = sim->getAgentMaxSpeed(i);
+				programs[i].prefVelocity = sim->getAgentPrefVelocity(i);
+			}
+		}
+	}
+
+	delete sim;
+}
+
+/* Times the linear programs on the recorded ORCA lines. */
+json benchmarkLinearPrograms(size_t numAgents, size_t numRepetitions)
+{
+	std::vector<LinearProgram> programs;
+	recordLinearPrograms(numAgents, programs);
+
+	std::vector<RVO::Line> projLines;
+	size_t numLines = 0;
+	size_t numInfeasible = 0;
+	double seconds2 = 0.0;
+	double seconds3 = 0.0;
+	float checksum = 0.0f;
+
+	for (size_t repetition = 0; repetition < numRepetitions; ++repetition) {
+		for (size_t i = 0; i < programs.size(); ++i) {
+			const LinearProgram &program = programs[i];
+			const RVO::Line *const lines = program.lines.empty() ? NULL : &program.lines[0];
+			RVO::Vector2 result;
+
+			double startTime = getWallTime();
+			const size_t lineFail = RVO::linearProgram2(lines, program.lines.size(), program.maxSpeed, program.prefVelocity, false, result);
+			double endTime = getWallTime();
+			seconds2 += endTime - startTime;
+
+			if (lineFail < program.lines.size()) {
+				projLines.resize(std::max(projLines.size(), program.lines.size()));
+
+				/* The Crossing scenario has no obstacles, so there are no obstacle lines. */
+				startTime = getWallTime();
+				RVO::linearProgram3(lines, program.lines.size(), 0, lineFail, program.maxSpeed, &projLines[0], result);
+				endTime = getWallTime();
+				seconds3 += endTime - startTime;
+
+				++numInfeasible;
+			}
+
+			numLines += program.lines.size();
+			checksum += result.x() + result.y();
+		}
+	}
+
+	const size_t numPrograms = numRepetitions * programs.size();
+
+	json result;
+	result["kernel"] = "linearProgram";
+	result["programs"] = numPrograms;
+	result["averageLines"] = static_cast<double>(numLines) / numPrograms;
+	result["infeasible"] = numInfeasible;
+	result["nsPerLinearProgram2"] = 1.0e9 * seconds2 / numPrograms;
+	result["nsPerLinearProgram3"] = (numInfeasible > 0 ? 1.0e9 * seconds3 / numInfeasible : 0.0);
+	result["checksum"] = checksum;
+
+	return result;
+}
+
+/*
+ * Adds a grid of gridSize by gridSize square obstacles of side 2, rotated by
+ * random angles so that the obstacle kd-tree has to split edges.
+ */
+void addObstacleGrid(RVO::RVOSimulator *sim, size_t gridSize)
+{
+	unsigned int seed = 1;
+
+	for (size_t i = 0; i < gridSize; ++i) {
+		for (size_t j = 0; j < gridSize; ++j) {
+			const RVO::Vector2 center(5.0f * i + 1.0f, 5.0f * j + 1.0f);
+			const float angle = scenarioRandom(seed) * 0.5f * M_PI;
+			const RVO::Vector2 axis1(std::cos(angle), std::sin(angle));
+			const RVO::Vector2 axis2(-axis1.y(), axis1.x());
+
+			std::vector<RVO::Vector2> obstacle;
+			obstacle.push_back(center - axis1 - axis2);
+			obstacle.push_back(center + axis1 - axis2);
+			obstacle.push_back(center + axis1 + axis2);
+			obstacle.push_back(center - axis1 + axis2);
+			sim->addObstacle(obstacle);
+		}
+	}
+}
+
+/*
+ * Times the build and visibility queries of the obstacle kd-tree, and
+ * measures its quality by the number of edges split by the build and the
+ * number of nodes visited by obstacle neighbor queries of agents between the
+ * blocks.
+ */
+json benchmarkObstacleTree(size_t gridSize, size_t numQueries)
+{
+	RVO::RVOSimulator *sim = new RVO::RVOSimulator();
+	addObstacleGrid(sim, gridSize);
+
+	const size_t numInputVertices = sim->getNumObstacleVertices();
+
+	const double buildStartTime = getWallTime();
+	sim->processObstacles();
+	const double buildSeconds = getWallTime() - buildStartTime;
+
+	const float extent = 5.0f * gridSize;
+	unsigned int seed = 1;
+	size_t numVisible = 0;
+
+	const double queryStartTime = getWallTime();
+
+	for (size_t i = 0; i < numQueries; ++i) {
+		const RVO::Vector2 point1(extent * scenarioRandom(seed), extent * scenarioRandom(seed));
+		const RVO::Vector2 point2 = point1 + RVO::Vector2(20.0f * scenarioRandom(seed) - 10.0f, 20.0f * scenarioRandom(seed) - 10.0f);
+
+		if (sim->queryVisibility(point1, point2, 0.5f)) {
+			++numVisible;
+		}
+	}
+
+	const double querySeconds = getWallTime() - queryStartTime;
+
+	/*
+	 * Roadmap-style queries from a few points to many targets around each,
+	 * answered one at a time and as a batch.
+	 */
+	std::vector<RVO::Vector2> points1;
+	std::vector<RVO::Vector2> points2;
+
+	while (points1.size() < numQueries) {
+		const RVO::Vector2 point1(extent * scenarioRandom(seed), extent * scenarioRandom(seed));
+
+		for (size_t i = 0; i < 64 && points1.size() < numQueries; ++i) {
+			points1.push_back(point1);
+			points2.push_back(point1 + RVO::Vector2(20.0f * scenarioRandom(seed) - 10.0f, 20.0f * scenarioRandom(seed) - 10.0f));
+		}
+	}
+
+	const std::vector<float> radii(numQueries, 0.5f);
+	size_t numCoherentVisible = 0;
+
+	const double coherentStartTime = getWallTime();
+
+	for (size_t i = 0; i < numQueries; ++i) {
+		if (sim->queryVisibility(points1[i], points2[i], radii[i])) {
+			++numCoherentVisible;
+		}
+	}
+
+	const double coherentSeconds = getWallTime() - coherentStartTime;
+
+	std::vector<std::uint64_t> visibility;
+
+	const double batchStartTime = getWallTime();
+	sim->queryVisibility(points1, points2, radii, visibility);
+	const double batchSeconds = getWallTime() - batchStartTime;
+
+	size_t numBatchVisible = 0;
+
+	for (size_t i = 0; i < numQueries; ++i) {
+		if ((visibility[i / 64] >> (i % 64)) & 1) {
+			++numBatchVisible;
+		}
+	}
+
+	sim->setAgentDefaults(5.0f, 10, 5.0f, 5.0f, 0.5f, 2.0f);
+
+	for (size_t i = 0; i < gridSize; ++i) {
+		for (size_t j = 0; j < gridSize; ++j) {
+			sim->addAgent(RVO::Vector2(5.0f * i + 3.5f, 5.0f * j + 3.5f));
+		}
+	}
+
+	sim->doStep();
+
+	const RVO::StepStatistics statistics = sim->getTotalStepStatistics();
+
+	json result;
+	result["kernel"] = "obstacleTree";
+	result["obstacleVertices"] = numInputVertices;
+	result["splitEdges"] = sim->getNumObstacleVertices() - numInputVertices;
+	result["buildMs"] = 1000.0 * buildSeconds;
+	result["queries"] = numQueries;
+	result["visible"] = numVisible;
+	result["nsPerVisibilityQuery"] = 1.0e9 * querySeconds / numQueries;
+	result["coherentVisible"] = numCoherentVisible;
+	result["batchVisible"] = numBatchVisible;
+	result["nsPerCoherentVisibilityQuery"] = 1.0e9 * coherentSeconds / numQueries;
+	result["nsPerBatchVisibilityQuery"] = 1.0e9 * batchSeconds / numQueries;
+
+	if (statistics.numAgents > 0) {
+		result["nodeVisitsPerNeighborQuery"] = static_cast<double>(statistics.numObstacleTreeNodeVisits) / statistics.numAgents;
+		result["obstacleNeighborsPerQuery"] = static_cast<double>(statistics.numObstacleNeighbors) / statistics.numAgents;
+	}
+
+	delete sim;
+
+	return result;
+}
+
+/*
+ * Times the build of the goal distance fields of a navigation grid of unit
+ * cells over a grid of blocks, with one goal in each corner, and the lookup
+ * of the preferred velocities of agents at random positions towards them.
+ */
+json benchmarkNavigation(size_t gridSize, size_t numAgents, size_t numRepetitions)
+{
+	RVO::RVOSimulator *sim = new RVO::RVOSimulator();
+	addObstacleGrid(sim, gridSize);
+	sim->processObstacles();
+
+	const float extent = 5.0f * gridSize;
+
+	const double buildStartTime = getWallTime();
+
+	sim->setNavigationGrid(RVO::Vector2(-2.0f, -2.0f), RVO::Vector2(extent, extent), 1.0f, 0.5f);
+	sim->addNavigationGoal(RVO::Vector2(-1.5f, -1.5f));
+	sim->addNavigationGoal(RVO::Vector2(extent - 0.5f, -1.5f));
+	sim->addNavigationGoal(RVO::Vector2(-1.5f, extent - 0.5f));
+	sim->addNavigationGoal(RVO::Vector2(extent - 0.5f, extent - 0.5f));
+
+	const double buildSeconds = getWallTime() - buildStartTime;
+
+	sim->setTimeStep(0.25f);
+	sim->setAgentDefaults(5.0f, 10, 5.0f, 5.0f, 0.5f, 2.0f);
+
+	unsigned int seed = 1;
+	std::vector<size_t> goalNos;
+
+	for (size_t i = 0; i < numAgents; ++i) {
+		sim->addAgent(RVO::Vector2(extent * scenarioRandom(seed), extent * scenarioRandom(seed)));
+		goalNos.push_back(i % 4);
+	}
+
+	const double lookupStartTime = getWallTime();
+
+	for (size_t i = 0; i < numRepetitions; ++i) {
+		sim->setAgentPrefVelocitiesToGoals(goalNos);
+	}
+
+	const double lookupSeconds = getWallTime() - lookupStartTime;
+
+	double checksum = 0.0;
+
+	for (size_t i = 0; i < numAgents; ++i) {
+		checksum += sim->getAgentPrefVelocity(i).x() + sim->getAgentPrefVelocity(i).y();
+	}
+
+	json result;
+	result["kernel"] = "navigation";
+	result["obstacleVertices"] = sim->getNumObstacleVertices();
+	result["cells"] = static_cast<size_t>((extent + 2.0f) * (extent + 2.0f));
+	result["goals"] = 4;
+	result["buildMs"] = 1000.0 * buildSeconds;
+	result["agents"] = numAgents;
+	result["nsPerPrefVelocity"] = 1.0e9 * lookupSeconds / (numRepetitions * numAgents);
+	result["checksum"] = checksum;
+
+	delete sim;
+
+	return result;
+}
+
+/*
+ * Times the build and neighbor queries of the agent kd-tree through the step
+ * statistics of the simulator. The neighbor queries include the obstacle
+ * neighbor queries.
+ */
+json benchmarkAgentTree(ScenarioType scenario, size_t numAgents, size_t numSteps)
+{
+	RVO::RVOSimulator *sim = new RVO::RVOSimulator();
+	std::vector<RVO::Vector2> goals;
+	unsigned int seed = 1;
+
+	setupScenario(sim, scenario, numAgents, goals);
+
+	RVO::StepStatistics total;
+
+	for (size_t step = 0; step < numSteps; ++step) {
+		setPreferredVelocities(sim, goals, seed);
+		sim->doStep();
+
+		const RVO::StepStatistics statistics = sim->getTotalStepStatistics();
+		total.numAgentIndexNodeVisits += statistics.numAgentIndexNodeVisits;
+		total.numAgentNeighbors += statistics.numAgentNeighbors;
+		total.numAgents += statistics.numAgents;
+		total.phaseTimes[RVO::RVO_PHASE_BUILD_AGENT_INDEX] += statistics.phaseTimes[RVO::RVO_PHASE_BUILD_AGENT_INDEX];
+		total.phaseTimes[RVO::RVO_PHASE_COMPUTE_NEIGHBORS] += statistics.phaseTimes[RVO::RVO_PHASE_COMPUTE_NEIGHBORS];
+	}
+
+	const bool instrumented = !sim->getStepStatistics().empty();
+
+	delete sim;
+
+	if (!instrumented) {
+		return json();
+	}
+
+	json result;
+	result["kernel"] = "agentTree";
+	result["scenario"] = SCENARIO_NAMES[scenario];
+	result["agents"] = numAgents;
+	result["steps"] = numSteps;
+	result["buildMs"] = 1000.0 * total.phaseTimes[RVO::RVO_PHASE_BUILD_AGENT_INDEX] / numSteps;
+	result["nsPerNeighborQuery"] = 1.0e9 * total.phaseTimes[RVO::RVO_PHASE_COMPUTE_NEIGHBORS] / total.numAgents;
+	result["nodeVisitsPerQuery"] = static_cast<double>(total.numAgentIndexNodeVisits) / total.numAgents;
+	result["neighborsPerQuery"] = static_cast<double>(total.numAgentNeighbors) / total.numAgents;
+
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	const size_t numAgents = (argc > 1 ? std::strtoul(argv[1], NULL, 10) : 2000);
+	const size_t numRepetitions = (argc > 2 ? std::strtoul(argv[2], NULL, 10) : 10);
+
+	json results = json::array();
+
+	results.push_back(benchmarkLinearPrograms(numAgents, numRepetitions));
+
+	for (size_t gridSize = 8; gridSize <= 128; gridSize *= 2) {
+		results.push_back(benchmarkObstacleTree(gridSize, 10000 * numRepetitions));
+	}
+
+	for (size_t gridSize = 8; gridSize <= 32; gridSize *= 2) {
+		results.push_back(benchmarkNavigation(gridSize, 10 * numAgents, numRepetitions));
+	}
+
+	bool instrumented = true;
+
+	for (size_t scenario = SCENARIO_CIRCLE; scenario <= SCENARIO_BLOCKS && instrumented; ++scenario) {
+		for (size_t agents = numAgents; agents <= 100 * numAgents && instrumented; agents *= 10) {
+			const json result = benchmarkAgentTree(static_cast<ScenarioType>(scenario), agents, numRepetitions);
+			instrumented = !result.is_null();
+
+			if (instrumented) {
+				results.push_back(result);
+			}
+		}
+	}
+
+	if (!instrumented) {
+		std::fprintf(stderr, "Kernels: the agent kd-tree is only timed when the library is compiled with RVO_INSTRUMENTATION=1.\n");
+	}
+
+	writeReport("kernels", results);
+
+	return 0;
+}
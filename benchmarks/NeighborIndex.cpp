@@ -0,0 +1,113 @@
+/*
+ * NeighborIndex.cpp
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+/*
+ * Benchmark comparing the agent neighbor indices of the simulator, the
+ * kd-tree and the spatial hash, on the Circle, Blocks and Crossing scenarios.
+ *
+ * Usage: NeighborIndex [number of agents] [number of steps]
+ */
+
+#include <cstdlib>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Scenarios.h"
+
+/* Runs a scenario with an agent neighbor index and returns its throughput. */
+json runScenario(ScenarioType scenario, RVO::NeighborIndexType index, size_t numAgents, size_t numSteps, std::vector<RVO::Vector2> &positions)
+{
+	RVO::RVOSimulator *sim = new RVO::RVOSimulator();
+	std::vector<RVO::Vector2> goals;
+	unsigned int seed = 1;
+
+	setupScenario(sim, scenario, numAgents, goals);
+	sim->setAgentNeighborIndex(index);
+
+	double seconds = 0.0;
+
+	for (size_t step = 0; step < numSteps; ++step) {
+		setPreferredVelocities(sim, goals, seed);
+
+		const double startTime = getWallTime();
+		sim->doStep();
+		seconds += getWallTime() - startTime;
+	}
+
+	positions = sim->getAgentPositions();
+
+	json result = makeStepResult(numSteps * sim->getNumAgents(), numSteps, seconds);
+	result["scenario"] = SCENARIO_NAMES[scenario];
+	result["index"] = (index == RVO::RVO_KD_TREE ? "kdTree" : "spatialHash");
+	result["agents"] = sim->getNumAgents();
+
+	delete sim;
+
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	const size_t numAgents = (argc > 1 ? std::strtoul(argv[1], NULL, 10) : 2000);
+	const size_t numSteps = (argc > 2 ? std::strtoul(argv[2], NULL, 10) : 100);
+
+	json results = json::array();
+
+	for (size_t scenario = 0; scenario < NUM_SCENARIOS; ++scenario) {
+		std::vector<RVO::Vector2> kdTreePositions;
+		std::vector<RVO::Vector2> hashPositions;
+
+		const json kdTreeResult = runScenario(static_cast<ScenarioType>(scenario), RVO::RVO_KD_TREE, numAgents, numSteps, kdTreePositions);
+		json hashResult = runScenario(static_cast<ScenarioType>(scenario), RVO::RVO_SPATIAL_HASH, numAgents, numSteps, hashPositions);
+
+		/*
+		 * Both indices find the same neighbors; trajectories only deviate when
+		 * neighbors at equal distance are visited in a different order.
+		 */
+		float maxDeviation = 0.0f;
+
+		for (size_t i = 0; i < kdTreePositions.size(); ++i) {
+			maxDeviation = std::max(maxDeviation, RVO::abs(kdTreePositions[i] - hashPositions[i]));
+		}
+
+		/* Speedup of the spatial hash relative to the kd-tree. */
+		hashResult["speedup"] = hashResult["stepsPerSecond"].get<double>() / kdTreeResult["stepsPerSecond"].get<double>();
+		hashResult["maxDeviation"] = maxDeviation;
+
+		results.push_back(kdTreeResult);
+		results.push_back(hashResult);
+	}
+
+	writeReport("neighborIndex", results);
+
+	return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Scaling.cpp
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+/*
+ * Scaling benchmark of the simulation step on the Circle and Blocks
+ * scenarios, from a thousand agents up to a maximum number of agents in
+ * powers of ten, for each thread count from one up to the number of hardware
+ * threads.
+ *
+ * Usage: Scaling [maximum number of agents] [maximum number of threads]
+ */
+
+#include <cstdlib>
+#include <vector>
+
+#include "Benchmark.h"
+#include "Scenarios.h"
+
+/* Enough steps for a stable measurement, but few for large scenarios. */
+size_t getNumSteps(size_t numAgents)
+{
+	return std::max<size_t>(5, std::min<size_t>(100, 10000000 / numAgents));
+}
+
+/* Runs a scenario on a number of threads and returns its throughput. */
+json runScenario(ScenarioType scenario, size_t numAgents, size_t numThreads)
+{
+	RVO::RVOSimulator *sim = new RVO::RVOSimulator();
+	std::vector<RVO::Vector2> goals;
+	unsigned int seed = 1;
+
+	setupScenario(sim, scenario, numAgents, goals);
+	sim->setNumThreads(numThreads);
+
+	/* The first step allocates the neighbor and ORCA line buffers. */
+	setPreferredVelocities(sim, goals, seed);
+	sim->doStep();
+
+	const size_t numSteps = getNumSteps(numAgents);
+	double seconds = 0.0;
+
+	/* The counters only see the calling thread, so all of the work when serial. */
+	CacheMissCounter cacheMisses;
+
+	for (size_t step = 0; step < numSteps; ++step) {
+		setPreferredVelocities(sim, goals, seed);
+
+		const double startTime = getWallTime();
+		cacheMisses.start();
+		sim->doStep();
+		cacheMisses.stop();
+		seconds += getWallTime() - startTime;
+	}
+
+	json result = makeStepResult(numSteps * sim->getNumAgents(), numSteps, seconds);
+	result["scenario"] = SCENARIO_NAMES[scenario];
+	result["agents"] = sim->getNumAgents();
+	result["threads"] = numThreads;
+
+	if (numThreads == 1 && cacheMisses.isAvailable()) {
+		result["l1DataMissesPerStep"] = static_cast<double>(cacheMisses.getMisses(CacheMissCounter::L1_DATA)) / numSteps;
+		result["lastLevelMissesPerStep"] = static_cast<double>(cacheMisses.getMisses(CacheMissCounter::LAST_LEVEL)) / numSteps;
+	}
+
+	delete sim;
+
+	return result;
+}
+
+int main(int argc, char *argv[])
+{
+	const size_t maxAgents = (argc > 1 ? std::strtoul(argv[1], NULL, 10) : 1000000);
+	const std::vector<size_t> threadCounts = getThreadCounts(argc > 2 ? std::strtoul(argv[2], NULL, 10) : 0);
+
+	json results = json::array();
+
+	for (size_t scenario = SCENARIO_CIRCLE; scenario <= SCENARIO_BLOCKS; ++scenario) {
+		for (size_t numAgents = 1000; numAgents <= maxAgents; numAgents *= 10) {
+			double serialStepsPerSecond = 0.0;
+
+			for (size_t i = 0; i < threadCounts.size(); ++i) {
+				json result = runScenario(static_cast<ScenarioType>(scenario), numAgents, threadCounts[i]);
+
+				if (i == 0) {
+					serialStepsPerSecond = result["stepsPerSecond"];
+				}
+
+				/* Thread scaling relative to the smallest thread count. */
+				result["speedup"] = result["stepsPerSecond"].get<double>() / serialStepsPerSecond;
+				results.push_back(result);
+			}
+		}
+	}
+
+	writeReport("scaling", results);
+
+	return 0;
+}
@@ -0,0 +1,222 @@
+/*
+ * Scenarios.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+/*
+ * Scenario setups shared by the benchmarks: scaled versions of the Circle and
+ * Blocks examples and of the Crossing pedestrian simulation.
+ */
+
+#ifndef RVO_BENCHMARKS_SCENARIOS_H_
+#define RVO_BENCHMARKS_SCENARIOS_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include <RVO.h>
+
+#ifndef M_PI
+const float M_PI = 3.14159265358979323846f;
+#endif
+
+enum ScenarioType {
+	SCENARIO_CIRCLE,
+	SCENARIO_BLOCKS,
+	SCENARIO_CROSSING
+};
+
+const char *const SCENARIO_NAMES[] = { "Circle", "Blocks", "Crossing" };
+
+const size_t NUM_SCENARIOS = 3;
+
+/* Deterministic random numbers, so that all runs of a scenario are equal. */
+inline float scenarioRandom(unsigned int &seed)
+{
+	seed = seed * 1103515245u + 12345u;
+
+	return static_cast<float>((seed >> 8) & 0xffffu) / 65535.0f;
+}
+
+/*
+ * Agents evenly distributed on a circle, moving to the antipodal position.
+ * The circle grows with the number of agents to keep the density of the
+ * Circle example.
+ */
+inline void setupCircle(RVO::RVOSimulator *sim, size_t numAgents, std::vector<RVO::Vector2> &goals)
+{
+	sim->setTimeStep(0.25f);
+	sim->setAgentDefaults(15.0f, 10, 10.0f, 10.0f, 1.5f, 2.0f);
+
+	const float radius = 200.0f * std::max(1.0f, numAgents / 250.0f);
+
+	for (size_t i = 0; i < numAgents; ++i) {
+		sim->addAgent(radius * RVO::Vector2(std::cos(i * 2.0f * M_PI / numAgents), std::sin(i * 2.0f * M_PI / numAgents)));
+		goals.push_back(-sim->getAgentPosition(i));
+	}
+}
+
+/*
+ * Four groups of agents in the corners of the environment, moving to the
+ * opposite corner through the narrow passages between four blocks.
+ */
+inline void setupBlocks(RVO::RVOSimulator *sim, size_t numAgents, std::vector<RVO::Vector2> &goals)
+{
+	sim->setTimeStep(0.25f);
+	sim->setAgentDefaults(15.0f, 10, 5.0f, 5.0f, 2.0f, 2.0f);
+
+	const size_t side = static_cast<size_t>(std::ceil(std::sqrt(numAgents / 4.0f)));
+
+	for (size_t i = 0; i < side; ++i) {
+		for (size_t j = 0; j < side && goals.size() < numAgents; ++j) {
+			sim->addAgent(RVO::Vector2(55.0f + i * 10.0f, 55.0f + j * 10.0f));
+			goals.push_back(RVO::Vector2(-75.0f, -75.0f));
+
+			sim->addAgent(RVO::Vector2(-55.0f - i * 10.0f, 55.0f + j * 10.0f));
+			goals.push_back(RVO::Vector2(75.0f, -75.0f));
+
+			sim->addAgent(RVO::Vector2(55.0f + i * 10.0f, -55.0f - j * 10.0f));
+			goals.push_back(RVO::Vector2(-75.0f, 75.0f));
+
+			sim->addAgent(RVO::Vector2(-55.0f - i * 10.0f, -55.0f - j * 10.0f));
+			goals.push_back(RVO::Vector2(75.0f, 75.0f));
+		}
+	}
+
+	std::vector<RVO::Vector2> obstacle1, obstacle2, obstacle3, obstacle4;
+
+	obstacle1.push_back(RVO::Vector2(-10.0f, 40.0f));
+	obstacle1.push_back(RVO::Vector2(-40.0f, 40.0f));
+	obstacle1.push_back(RVO::Vector2(-40.0f, 10.0f));
+	obstacle1.push_back(RVO::Vector2(-10.0f, 10.0f));
+
+	obstacle2.push_back(RVO::Vector2(10.0f, 40.0f));
+	obstacle2.push_back(RVO::Vector2(10.0f, 10.0f));
+	obstacle2.push_back(RVO::Vector2(40.0f, 10.0f));
+	obstacle2.push_back(RVO::Vector2(40.0f, 40.0f));
+
+	obstacle3.push_back(RVO::Vector2(10.0f, -40.0f));
+	obstacle3.push_back(RVO::Vector2(40.0f, -40.0f));
+	obstacle3.push_back(RVO::Vector2(40.0f, -10.0f));
+	obstacle3.push_back(RVO::Vector2(10.0f, -10.0f));
+
+	obstacle4.push_back(RVO::Vector2(-10.0f, -40.0f));
+	obstacle4.push_back(RVO::Vector2(-10.0f, -10.0f));
+	obstacle4.push_back(RVO::Vector2(-40.0f, -10.0f));
+	obstacle4.push_back(RVO::Vector2(-40.0f, -40.0f));
+
+	sim->addObstacle(obstacle1);
+	sim->addObstacle(obstacle2);
+	sim->addObstacle(obstacle3);
+	sim->addObstacle(obstacle4);
+
+	sim->processObstacles();
+}
+
+/*
+ * Two crowds of pedestrians waiting at the curbs of a road, with the
+ * parameters of pedestrian_sim/Crossing.cpp, crossing to the opposite curb.
+ * The crowds grow away from the road with the number of agents.
+ */
+inline void setupCrossing(RVO::RVOSimulator *sim, size_t numAgents, std::vector<RVO::Vector2> &goals)
+{
+	sim->setTimeStep(1.0f);
+
+	/* One shared profile per hurry level; the maximum speed grows with it. */
+	const size_t hurryLevels = 11;
+	size_t hurryProfiles[hurryLevels];
+
+	for (size_t hurry = 0; hurry < hurryLevels; ++hurry) {
+		hurryProfiles[hurry] = sim->addProfile(10.0f, 10, 0.1f, 0.1f, 0.09f * (15 + hurry) / 20);
+	}
+
+	const size_t rows = 24;
+	unsigned int seed = 1;
+
+	for (size_t i = 0; i < numAgents; ++i) {
+		const size_t k = i / 2;
+		const float offsetX = 0.7f * (k / rows) + 0.2f * scenarioRandom(seed);
+		const float y = -8.4f + 0.7f * (k % rows) + 0.2f * scenarioRandom(seed);
+
+		const size_t profileNo = hurryProfiles[k % hurryLevels];
+
+		if (i % 2 == 0) {
+			sim->addAgent(RVO::Vector2(-14.2f - offsetX, y), profileNo, 0.3f);
+			goals.push_back(RVO::Vector2(10.0f + offsetX, y));
+		}
+		else {
+			sim->addAgent(RVO::Vector2(10.0f + offsetX, y), profileNo, 0.3f);
+			goals.push_back(RVO::Vector2(-14.2f - offsetX, y));
+		}
+	}
+}
+
+inline void setupScenario(RVO::RVOSimulator *sim, ScenarioType scenario, size_t numAgents, std::vector<RVO::Vector2> &goals)
+{
+	goals.clear();
+
+	switch (scenario) {
+		case SCENARIO_CIRCLE:
+			setupCircle(sim, numAgents, goals);
+			break;
+		case SCENARIO_BLOCKS:
+			setupBlocks(sim, numAgents, goals);
+			break;
+		case SCENARIO_CROSSING:
+			setupCrossing(sim, numAgents, goals);
+			break;
+	}
+}
+
+/*
+ * Set the preferred velocity to be a vector of at most the maximum speed in
+ * the direction of the goal, perturbed a little to avoid deadlocks due to
+ * perfect symmetry.
+ */
+inline void setPreferredVelocities(RVO::RVOSimulator *sim, const std::vector<RVO::Vector2> &goals, unsigned int &seed)
+{
+	for (size_t i = 0; i < sim->getNumAgents(); ++i) {
+		RVO::Vector2 goalVector = goals[i] - sim->getAgentPosition(i);
+		const float maxSpeed = sim->getAgentMaxSpeed(i);
+
+		if (RVO::absSq(goalVector) > maxSpeed * maxSpeed) {
+			goalVector = maxSpeed * RVO::normalize(goalVector);
+		}
+
+		const float angle = scenarioRandom(seed) * 2.0f * M_PI;
+		const float dist = scenarioRandom(seed) * 0.0001f;
+
+		sim->setAgentPrefVelocity(i, goalVector + dist * RVO::Vector2(std::cos(angle), std::sin(angle)));
+	}
+}
+
+#endif /* RVO_BENCHMARKS_SCENARIOS_H_ */
@@ -46,6 +46,7 @@
 #endif
 
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <map>
 #include <vector>
@@ -212,13 +213,32 @@ void updateVisualization(RVO::RVOSimulator *sim)
 
 void buildRoadmap(RVO::RVOSimulator *sim)
 {
-	/* Connect the roadmap vertices by edges if mutually visible. */
+	/*
+	 * Connect the roadmap vertices by edges if mutually visible, querying the
+	 * visibility of all pairs of vertices in one batch.
+	 */
+	std::vector<RVO::Vector2> points1;
+	std::vector<RVO::Vector2> points2;
+
+	for (size_t i = 0; i < roadmap.size(); ++i) {
+		for (size_t j = 0; j < roadmap.size(); ++j) {
+			points1.push_back(roadmap[i].position);
+			points2.push_back(roadmap[j].position);
+		}
+	}
+
+	std::vector<float> radii(points1.size(), sim->getAgentRadius(0));
+	std::vector<std::uint64_t> visibility;
+	sim->queryVisibility(points1, points2, radii, visibility);
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
 	for (int i = 0; i < static_cast<int>(roadmap.size()); ++i) {
 		for (int j = 0; j < static_cast<int>(roadmap.size()); ++j) {
-			if (sim->queryVisibility(roadmap[i].position, roadmap[j].position, sim->getAgentRadius(0))) {
+			const size_t queryNo = i * roadmap.size() + j;
+
+			if ((visibility[queryNo / 64] >> (queryNo % 64)) & 1) {
 				roadmap[i].neighbors.push_back(j);
 			}
 		}
@@ -274,8 +294,24 @@ void setPreferredVelocities(RVO::RVOSimulator *sim)
 	/*
 	 * Set the preferred velocity to be a vector of unit magnitude (speed) in the
 	 * direction of the visible roadmap vertex that is on the shortest path to the
-	 * goal.
+	 * goal. The visibility of all roadmap vertices from all agents is queried
+	 * in one batch.
 	 */
+	std::vector<RVO::Vector2> points1;
+	std::vector<RVO::Vector2> points2;
+	std::vector<float> radii;
+
+	for (size_t i = 0; i < sim->getNumAgents(); ++i) {
+		for (size_t j = 0; j < roadmap.size(); ++j) {
+			points1.push_back(sim->getAgentPosition(i));
+			points2.push_back(roadmap[j].position);
+			radii.push_back(sim->getAgentRadius(i));
+		}
+	}
+
+	std::vector<std::uint64_t> visibility;
+	sim->queryVisibility(points1, points2, radii, visibility);
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
@@ -284,8 +320,10 @@ void setPreferredVelocities(RVO::RVOSimulator *sim)
 		int minVertex = -1;
 
 		for (int j = 0; j < static_cast<int>(roadmap.size()); ++j) {
+			const size_t queryNo = i * roadmap.size() + j;
+
 			if (RVO::abs(roadmap[j].position - sim->getAgentPosition(i)) + roadmap[j].distToGoal[goals[i]] < minDist &&
-				sim->queryVisibility(sim->getAgentPosition(i), roadmap[j].position, sim->getAgentRadius(i))) {
+				((visibility[queryNo / 64] >> (queryNo % 64)) & 1)) {
 
 				minDist = RVO::abs(roadmap[j].position - sim->getAgentPosition(i)) + roadmap[j].distToGoal[goals[i]];
 				minVertex = j;
@@ -40,14 +40,37 @@
 #define RVO_OUTPUT_TIME_AND_POSITIONS 1
 #endif
 
+/*
+ * When nonzero, time the simulation and write its throughput as JSON to the
+ * standard output. Used by the end-to-end benchmark with the output of the
+ * positions disabled.
+ */
+#ifndef RVO_BENCHMARK
+#define RVO_BENCHMARK 0
+#endif
+
+/*
+ * The speed below which the simulator puts pedestrians waiting at the curb to
+ * sleep, zero to keep all of them awake. A sleep speed of 0.005f skips about
+ * 30% of the agent steps and moves no pedestrian by more than 5 mm.
+ */
+#ifndef RVO_AGENT_SLEEP_SPEED
+#define RVO_AGENT_SLEEP_SPEED 0.0f
+#endif
+
 #include <cmath>
 #include <cstddef>
 #include <vector>
 
-#if RVO_OUTPUT_TIME_AND_POSITIONS
+#if RVO_OUTPUT_TIME_AND_POSITIONS || RVO_BENCHMARK
 #include <iostream>
 #endif
 
+#if RVO_BENCHMARK
+#include <chrono>
+#include <cstdlib>
+#endif
+
 #if _OPENMP
 #include <omp.h>
 #endif
@@ -63,6 +86,7 @@ const float M_PI = 3.14159265358979323846f;
 
 #define nLeft 50
 #define nRight 100
+#define nHurryLevels 11
 int posRange = 30;
 int posMin = 0;
 int getThreLeft(int t, int hurry);
@@ -190,7 +214,8 @@ struct agt_fromL
 	bool running_from_buf;
 	float goal_x;
 	float goal_y;
-	int sim_index;
+	size_t sim_index;
+	bool crossed;
 };
 struct agt_fromR
 {
@@ -207,7 +232,8 @@ struct agt_fromR
 	bool running_from_buf;
 	float goal_x;
 	float goal_y;
-	int sim_index;
+	size_t sim_index;
+	bool crossed;
 };
 /* init waiting agent structure. */
 struct agt_fromL agt_fromL[nLeft];
@@ -216,13 +242,23 @@ struct agt_fromR agt_fromR[nRight];
 /* Store the goals of the agents. */
 std::vector<RVO::Vector2> goals;
 
+/* Store the preferred velocities of the agents, passed to the simulator at once. */
+std::vector<RVO::Vector2> prefVelocities;
+
+/* Store the agent profiles of the hurry levels, whose maximum speeds differ. */
+size_t hurryProfiles[nHurryLevels];
+
 void setupScenario(RVO::RVOSimulator *sim)
 {
 	/* Specify the global time step of the simulation. */
 	sim->setTimeStep(1.0f);
 
-	/* neighborDist, maxNeighbors, timeHorizon, timeHorizonObst, radius, maxSpeed */
-	sim->setAgentDefaults(10.0f, 10, 0.1f, 0.1f, 0.3f, 0.09f);
+	/* neighborDist, maxNeighbors, timeHorizon, timeHorizonObst, maxSpeed; maxspeed correlates to hurry level */
+	for (int hurry = 0; hurry < nHurryLevels; hurry++) {
+		hurryProfiles[hurry] = sim->addProfile(10.0f, 10, 0.1f, 0.1f, 0.09f*(15+hurry)/20);
+	}
+
+	sim->setAgentSleepSpeed(RVO_AGENT_SLEEP_SPEED);
 
 	/* Init with all agents as not waiting. */
 	for(int i = 0; i < nLeft; i++) {
@@ -239,9 +275,13 @@ void updateVisualization(RVO::RVOSimulator *sim)
 	/* Output the current global time. */
 	std::cout << sim->getGlobalTime();
 
-	/* Output the current position of all the agents. */
-	for (size_t i = 0; i < sim->getNumAgents(); ++i) {
-		std::cout << " " << sim->getAgentPosition(i);
+	/* Output the current position of all the agents still on the scene. */
+	const std::vector<RVO::Vector2> &positions = sim->getAgentPositions();
+
+	for (size_t i = 0; i < positions.size(); ++i) {
+		if (sim->isAgentActive(i)) {
+			std::cout << " " << positions[i];
+		}
 	}
 
 	std::cout << std::endl;
@@ -254,18 +294,28 @@ void setPreferredVelocities(RVO::RVOSimulator *sim)
 	 * Set the preferred velocity to be a vector of unit magnitude (speed) in the
 	 * direction of the goal.
 	 */
+	const std::vector<RVO::Vector2> &positions = sim->getAgentPositions();
+	prefVelocities.resize(positions.size());
+
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-	for (int i = 0; i < static_cast<int>(sim->getNumAgents()); ++i) {
-		RVO::Vector2 goalVector = goals[i] - sim->getAgentPosition(i);
+	for (int i = 0; i < static_cast<int>(positions.size()); ++i) {
+		if (!sim->isAgentActive(i)) {
+			prefVelocities[i] = RVO::Vector2();
+			continue;
+		}
+
+		RVO::Vector2 goalVector = goals[i] - positions[i];
 
 		if (RVO::absSq(goalVector) > 1.0f) {
 			goalVector = RVO::normalize(goalVector);
 		}
 
-		sim->setAgentPrefVelocity(i, goalVector);
+		prefVelocities[i] = goalVector;
 	}
+
+	sim->setAgentPrefVelocities(prefVelocities);
 }
 
 void thesisManipulation(RVO::RVOSimulator *sim)
@@ -281,7 +331,7 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 			for (int j = 0; j < 30; j++) {
 				bool this_occupy = false;
 				for (int k = 0; k < nLeft; k++) {
-					if (agt_fromL[k].waitingL && goals[agt_fromL[k].sim_index].x() == posL[j][0] &&
+					if (!agt_fromL[k].crossed && agt_fromL[k].waitingL && goals[agt_fromL[k].sim_index].x() == posL[j][0] &&
 						goals[agt_fromL[k].sim_index].y() == posL[j][1]) {
 						this_occupy = true;
 					}
@@ -302,7 +352,7 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 			while (occupy) {
 				occupy = false;
 				for (int k = 0; k < nLeft; k++) {
-					if (agt_fromL[k].waitingL && goals[agt_fromL[k].sim_index].x() == posL[p][0] &&
+					if (!agt_fromL[k].crossed && agt_fromL[k].waitingL && goals[agt_fromL[k].sim_index].x() == posL[p][0] &&
 						goals[agt_fromL[k].sim_index].y() == posL[p][1]) {
 						occupy = true;
 					}
@@ -319,10 +369,13 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 			agt_fromL[i].goal_x = dirL_goal[p][0];
 			agt_fromL[i].goal_y = dirL_goal[p][1];
 			agt_fromL[i].waitingL = true;
-			agt_fromL[i].sim_index = goals.size();
-			sim->addAgent(RVO::Vector2(agt_fromL[i].app_x, agt_fromL[i].app_y));
-			goals.push_back(RVO::Vector2(agt_fromL[i].app_x, agt_fromL[i].app_y));
-			sim->setAgentMaxSpeed(agt_fromL[i].sim_index, 0.09f*(15+agt_fromL[i].hurry)/20); // maxspeed correlates to hurry level
+			// the simulator reuses the slots of removed agents
+			agt_fromL[i].sim_index = sim->addAgent(RVO::Vector2(agt_fromL[i].app_x, agt_fromL[i].app_y), hurryProfiles[agt_fromL[i].hurry], 0.3f);
+			if (agt_fromL[i].sim_index == goals.size()) {
+				goals.push_back(RVO::Vector2(agt_fromL[i].app_x, agt_fromL[i].app_y));
+			} else {
+				goals[agt_fromL[i].sim_index] = RVO::Vector2(agt_fromL[i].app_x, agt_fromL[i].app_y);
+			}
 		}
 	}
 	/* Agents appear and wait - right */
@@ -333,7 +386,7 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 			for (int j = 0; j < 30; j++) {
 				bool this_occupy = false;
 				for (int k = 0; k < nRight; k++) {
-					if (agt_fromR[k].waitingR && goals[agt_fromR[k].sim_index].x() == posR[j][0] &&
+					if (!agt_fromR[k].crossed && agt_fromR[k].waitingR && goals[agt_fromR[k].sim_index].x() == posR[j][0] &&
 						goals[agt_fromR[k].sim_index].y() == posR[j][1]) {
 						this_occupy = true;
 					}
@@ -354,7 +407,7 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 			while (occupy) {
 				occupy = false;
 				for (int k = 0; k < nRight; k++) {
-					if (agt_fromR[k].waitingR && goals[agt_fromR[k].sim_index].x() == posR[p][0] &&
+					if (!agt_fromR[k].crossed && agt_fromR[k].waitingR && goals[agt_fromR[k].sim_index].x() == posR[p][0] &&
 						goals[agt_fromR[k].sim_index].y() == posR[p][1]) {
 						occupy = true;
 					}
@@ -371,16 +424,19 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 			agt_fromR[i].goal_x = dirR_goal[p][0];
 			agt_fromR[i].goal_y = dirR_goal[p][1];
 			agt_fromR[i].waitingR = true;
-			agt_fromR[i].sim_index = goals.size();
-			sim->addAgent(RVO::Vector2(agt_fromR[i].app_x, agt_fromR[i].app_y));
-			goals.push_back(RVO::Vector2(agt_fromR[i].app_x, agt_fromR[i].app_y));
-			sim->setAgentMaxSpeed(agt_fromR[i].sim_index, 0.09f*(15+agt_fromR[i].hurry)/20); // maxspeed correlates to hurry level
+			// the simulator reuses the slots of removed agents
+			agt_fromR[i].sim_index = sim->addAgent(RVO::Vector2(agt_fromR[i].app_x, agt_fromR[i].app_y), hurryProfiles[agt_fromR[i].hurry], 0.3f);
+			if (agt_fromR[i].sim_index == goals.size()) {
+				goals.push_back(RVO::Vector2(agt_fromR[i].app_x, agt_fromR[i].app_y));
+			} else {
+				goals[agt_fromR[i].sim_index] = RVO::Vector2(agt_fromR[i].app_x, agt_fromR[i].app_y);
+			}
 		}
 	}
 
 	/* Check running light - from left */
 	for (int i = 0; i < nLeft; i++) {
-		if (agt_fromL[i].waitingL == true && (
+		if (!agt_fromL[i].crossed && agt_fromL[i].waitingL == true && (
 		(sim->getGlobalTime() < 460) ||
 		(sim->getGlobalTime() > 1500))) {
 			int waiting_time = sim->getGlobalTime() - agt_fromL[i].app_time;
@@ -400,7 +456,7 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 	}
 	/* Check running light - from right */
 	for (int i = 0; i < nRight; i++) {
-		if (agt_fromR[i].waitingR && (
+		if (!agt_fromR[i].crossed && agt_fromR[i].waitingR && (
 		(sim->getGlobalTime() < 210) ||
 		(sim->getGlobalTime() > 540 && sim->getGlobalTime() < 810) ||
 		(sim->getGlobalTime() > 1035))) {
@@ -428,15 +484,15 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 	}
 	/* Goals at buffer avoid overlapping */
 	for (size_t i = 0; i < sim->getNumAgents(); i++) {
-		if (-3.0f < sim->getAgentPosition(i).x() && sim->getAgentPosition(i).x() < 3.0f) {
+		if (sim->isAgentActive(i) && -3.0f < sim->getAgentPosition(i).x() && sim->getAgentPosition(i).x() < 3.0f) {
 			for (size_t j = 0; j < sim->getNumAgents(); j++) {
-				if (i != j && goals[i].x() == sim->getAgentPosition(j).x() && goals[i].y() == sim->getAgentPosition(j).y()) {
+				if (i != j && sim->isAgentActive(j) && goals[i].x() == sim->getAgentPosition(j).x() && goals[i].y() == sim->getAgentPosition(j).y()) {
 					for (int m = 0; m < 42; m++) {
 						if (goals[i].x() == buff_sort[m][0] && goals[i].y() == buff_sort[m][1]) {
 							// match goals[index] and sim_index to reset goal
 							// sim_index either find in agt_fromL or agt_fromR
 							for (int n = 0; n < nLeft; n++) {
-								if (agt_fromL[n].sim_index == i) {
+								if (!agt_fromL[n].crossed && agt_fromL[n].sim_index == i) {
 									if (rand() % 2 == 0) {
 										if (m<41) {
 											agt_fromL[n].buf_x = buff_sort[m+1][0];
@@ -458,7 +514,7 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 								}
 							}
 							for (int n = 0; n < nRight; n++) {
-								if (agt_fromR[n].sim_index == i) {
+								if (!agt_fromR[n].crossed && agt_fromR[n].sim_index == i) {
 									if (rand() % 2 == 0) {
 										if (m<41) {
 											agt_fromR[n].buf_x = buff_sort[m+1][0];
@@ -488,8 +544,10 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 
 	/* Reach buffer reset state - from left */
 	for (int i = 0; i < nLeft; i++) {
-		if (agt_fromL[i].running_fromL) {
-			if (RVO::absSq(sim->getAgentPosition(i) - goals[i]) <= sim->getAgentRadius(i) * sim->getAgentRadius(i)) {
+		if (!agt_fromL[i].crossed && agt_fromL[i].running_fromL) {
+			// test the record's own agent, not the agent numbered like the record
+			size_t k = agt_fromL[i].sim_index;
+			if (RVO::absSq(sim->getAgentPosition(k) - goals[k]) <= sim->getAgentRadius(k) * sim->getAgentRadius(k)) {
 				agt_fromL[i].running_fromL = false;
 				agt_fromL[i].waiting_buf = true;
 				agt_fromL[i].buf_time = sim->getGlobalTime();
@@ -499,8 +557,10 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 	}
 	//* Reach buffer reset state - from right */
 	for (int i = 0; i < nRight; i++) {
-		if (agt_fromR[i].running_fromR) {
-			if (RVO::absSq(sim->getAgentPosition(i) - goals[i]) <= sim->getAgentRadius(i) * sim->getAgentRadius(i)) {
+		if (!agt_fromR[i].crossed && agt_fromR[i].running_fromR) {
+			// test the record's own agent, not the agent numbered like the record
+			size_t k = agt_fromR[i].sim_index;
+			if (RVO::absSq(sim->getAgentPosition(k) - goals[k]) <= sim->getAgentRadius(k) * sim->getAgentRadius(k)) {
 				agt_fromR[i].running_fromR = false;
 				agt_fromR[i].waiting_buf = true;
 				agt_fromR[i].buf_time = sim->getGlobalTime();
@@ -511,7 +571,7 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 
 	/* Check running light - buffer to left */
 	for (int i = 0; i < nRight; i++) {
-		if ((agt_fromR[i].waiting_buf == true) && (
+		if (!agt_fromR[i].crossed && (agt_fromR[i].waiting_buf == true) && (
 		(sim->getGlobalTime() < 540) ||
 		(sim->getGlobalTime() > 1500))) {
 			int waiting_time = sim->getGlobalTime() - agt_fromR[i].buf_time;
@@ -531,7 +591,7 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 	}
 	/* Check running light - buffer to right */
 	for (int i = 0; i < nLeft; i++) {
-		if ((agt_fromL[i].waiting_buf == true) && (
+		if (!agt_fromL[i].crossed && (agt_fromL[i].waiting_buf == true) && (
 		(sim->getGlobalTime() < 210) ||
 		(sim->getGlobalTime() > 540 && sim->getGlobalTime() < 810) ||
 		(sim->getGlobalTime() > 1035))) {
@@ -559,6 +619,9 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 
 	/* Light green - from left */
 	for (int i = 0; i < nLeft; i++) {
+		if (agt_fromL[i].crossed) {
+			continue;
+		}
 		if (agt_fromL[i].waitingL && (sim->getGlobalTime() > 1800)) { cross_statistics++; }
 		// the agents waiting at the left side
 		if ((agt_fromL[i].waitingL || agt_fromL[i].running_fromL) && (sim->getGlobalTime() > 1800)) {
@@ -574,6 +637,9 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 	}
 	/* Light green - from right */
 	for (int i = 0; i < nRight; i++) {
+		if (agt_fromR[i].crossed) {
+			continue;
+		}
 		if (agt_fromR[i].waitingR && (sim->getGlobalTime() > 1800)) { cross_statistics++; }
 		// the agents waiting at the right side
 		if ((agt_fromR[i].waitingR || agt_fromR[i].running_fromR) && (sim->getGlobalTime() > 1800)) {
@@ -590,20 +656,32 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 
 	/* Remove crossed agents - from left */
 	for (int i = 0; i < nLeft; i++) {
-		if (RVO::absSq(sim->getAgentPosition(agt_fromL[i].sim_index) - goals[agt_fromL[i].sim_index]) <= 0.09f &&
+		if (!agt_fromL[i].crossed &&
+			RVO::absSq(sim->getAgentPosition(agt_fromL[i].sim_index) - goals[agt_fromL[i].sim_index]) <= 0.09f &&
 			goals[agt_fromL[i].sim_index].x() == agt_fromL[i].goal_x && 
 			goals[agt_fromL[i].sim_index].y() == agt_fromL[i].goal_y) {
-				sim->setAgentPosition(agt_fromL[i].sim_index, RVO::Vector2(100.0f, 100.0f));
-				sim->setAgentMaxSpeed(agt_fromL[i].sim_index, 0.0f);
+				sim->removeAgent(agt_fromL[i].sim_index);
+				agt_fromL[i].crossed = true;
+				// the agent number may be handed to a new pedestrian, so retire the record
+				agt_fromL[i].waitingL = false;
+				agt_fromL[i].running_fromL = false;
+				agt_fromL[i].waiting_buf = false;
+				agt_fromL[i].running_from_buf = false;
 		}
 	}
 	/* Remove crossed agents - from right */
 	for (int i = 0; i < nRight; i++) {
-		if (RVO::absSq(sim->getAgentPosition(agt_fromR[i].sim_index) - goals[agt_fromR[i].sim_index]) <= 0.09f &&
+		if (!agt_fromR[i].crossed &&
+			RVO::absSq(sim->getAgentPosition(agt_fromR[i].sim_index) - goals[agt_fromR[i].sim_index]) <= 0.09f &&
 			goals[agt_fromR[i].sim_index].x() == agt_fromR[i].goal_x && 
 			goals[agt_fromR[i].sim_index].y() == agt_fromR[i].goal_y) {
-				sim->setAgentPosition(agt_fromR[i].sim_index, RVO::Vector2(100.0f, 100.0f));
-				sim->setAgentMaxSpeed(agt_fromR[i].sim_index, 0.0f);
+				sim->removeAgent(agt_fromR[i].sim_index);
+				agt_fromR[i].crossed = true;
+				// the agent number may be handed to a new pedestrian, so retire the record
+				agt_fromR[i].waitingR = false;
+				agt_fromR[i].running_fromR = false;
+				agt_fromR[i].waiting_buf = false;
+				agt_fromR[i].running_from_buf = false;
 		}
 	}
 
@@ -627,9 +705,14 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 	}
 
 	/* Store utilization data */
-	for (size_t i = 0; i < sim->getNumAgents(); i++) {
-		if (7.2f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > 6.0f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+	const std::vector<RVO::Vector2> &positions = sim->getAgentPositions();
+
+	for (size_t i = 0; i < positions.size(); i++) {
+		if (!sim->isAgentActive(i)) {
+			continue;
+		}
+		if (7.2f >= positions[i].y() && positions[i].y() > 6.0f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[0][0]++; break;
 				case 1: heatmap[0][1]++; break;
@@ -648,8 +731,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[0][14]++; break;
 				default: ;
 			}
-		} else if (6.0f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > 4.8f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (6.0f >= positions[i].y() && positions[i].y() > 4.8f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[1][0]++; break;
 				case 1: heatmap[1][1]++; break;
@@ -668,8 +751,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[1][14]++; break;
 				default: ;
 			}
-		} else if (4.8f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > 3.6f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (4.8f >= positions[i].y() && positions[i].y() > 3.6f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[2][0]++; break;
 				case 1: heatmap[2][1]++; break;
@@ -688,8 +771,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[2][14]++; break;
 				default: ;
 			}
-		} else if (3.6f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > 2.4f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (3.6f >= positions[i].y() && positions[i].y() > 2.4f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[3][0]++; break;
 				case 1: heatmap[3][1]++; break;
@@ -708,8 +791,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[3][14]++; break;
 				default: ;
 			}
-		} else if (2.4f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > 1.2f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (2.4f >= positions[i].y() && positions[i].y() > 1.2f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[4][0]++; break;
 				case 1: heatmap[4][1]++; break;
@@ -728,8 +811,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[4][14]++; break;
 				default: ;
 			}
-		} else if (1.2f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > 0.0f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (1.2f >= positions[i].y() && positions[i].y() > 0.0f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[5][0]++; break;
 				case 1: heatmap[5][1]++; break;
@@ -748,8 +831,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[5][14]++; break;
 				default: ;
 			}
-		} else if (0.0f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > -1.2f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (0.0f >= positions[i].y() && positions[i].y() > -1.2f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[6][0]++; break;
 				case 1: heatmap[6][1]++; break;
@@ -768,8 +851,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[6][14]++; break;
 				default: ;
 			}
-		} else if (-1.2f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > -2.4f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (-1.2f >= positions[i].y() && positions[i].y() > -2.4f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[7][0]++; break;
 				case 1: heatmap[7][1]++; break;
@@ -788,8 +871,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[7][14]++; break;
 				default: ;
 			}
-		} else if (-2.4f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > -3.6f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (-2.4f >= positions[i].y() && positions[i].y() > -3.6f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[8][0]++; break;
 				case 1: heatmap[8][1]++; break;
@@ -808,8 +891,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[8][14]++; break;
 				default: ;
 			}
-		} else if (-3.6f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > -4.8f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (-3.6f >= positions[i].y() && positions[i].y() > -4.8f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[9][0]++; break;
 				case 1: heatmap[9][1]++; break;
@@ -828,8 +911,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[9][14]++; break;
 				default: ;
 			}
-		} else if (-4.8f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > -6.0f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (-4.8f >= positions[i].y() && positions[i].y() > -6.0f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[10][0]++; break;
 				case 1: heatmap[10][1]++; break;
@@ -848,8 +931,8 @@ void thesisManipulation(RVO::RVOSimulator *sim)
 				case 14: heatmap[10][14]++; break;
 				default: ;
 			}
-		} else if (-6.0f >= sim->getAgentPosition(i).y() && sim->getAgentPosition(i).y() > -7.2f) {
-			switch (int(sim->getAgentPosition(i).x()/1.2f+9))
+		} else if (-6.0f >= positions[i].y() && positions[i].y() > -7.2f) {
+			switch (int(positions[i].x()/1.2f+9))
 			{
 				case 0: heatmap[11][0]++; break;
 				case 1: heatmap[11][1]++; break;
@@ -1110,7 +1193,7 @@ bool timeUp(RVO::RVOSimulator *sim)
 	return sim->getGlobalTime() > 2550.0f;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
 	/* Create a new simulator instance. */
 	RVO::RVOSimulator *sim = new RVO::RVOSimulator();
@@ -1118,6 +1201,16 @@ int main()
 	/* Set up the scenario. */
 	setupScenario(sim);
 
+#if RVO_BENCHMARK
+	/* The number of threads of the simulator, zero for OpenMP or sequential. */
+	const size_t numThreads = (argc > 1 ? std::strtoul(argv[1], NULL, 10) : 0);
+	sim->setNumThreads(numThreads);
+
+	const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	size_t numSteps = 0;
+	size_t numAgentSteps = 0;
+#endif
+
 	/* Perform (and manipulate) the simulation. */
 	do {
 #if RVO_OUTPUT_TIME_AND_POSITIONS
@@ -1126,9 +1219,30 @@ int main()
 		setPreferredVelocities(sim);
 		thesisManipulation(sim);
 		sim->doStep();
+
+#if RVO_BENCHMARK
+		++numSteps;
+
+		for (size_t i = 0; i < sim->getNumAgents(); ++i) {
+			numAgentSteps += sim->isAgentActive(i);
+		}
+#endif
 	}
 	while (!timeUp(sim));
 
+#if RVO_BENCHMARK
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+	json result;
+	result["benchmark"] = "crossing";
+	result["threads"] = numThreads;
+	result["steps"] = numSteps;
+	result["seconds"] = seconds;
+	result["stepsPerSecond"] = numSteps / seconds;
+	result["nsPerAgentStep"] = (numAgentSteps > 0 ? 1.0e9 * seconds / numAgentSteps : 0.0);
+	std::cout << result.dump(2) << std::endl;
+#endif
+
 	/* Get visualization statistics */
 	// statistics();
 
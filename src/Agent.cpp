@@ -34,30 +34,326 @@
 
 #include "KdTree.h"
 #include "Obstacle.h"
+#include "ObstacleGrid.h"
+
+#if RVO_SSE
+#include <emmintrin.h>
+#endif
 
 namespace RVO {
-	Agent::Agent(RVOSimulator *sim) : maxNeighbors_(0), maxSpeed_(0.0f), neighborDist_(0.0f), radius_(0.0f), sim_(sim), timeHorizon_(0.0f), timeHorizonObst_(0.0f), id_(0) { }
+#if RVO_SSE
+	namespace {
+		/* Selects the lanes of a where mask is set and the lanes of b elsewhere. */
+		inline __m128 selectSSE(__m128 mask, __m128 a, __m128 b)
+		{
+			return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+		}
+	}
+
+#endif
+	Agent::Agent(RVOSimulator *sim) : buildingNeighborList_(false), neighborListValid_(false), numLinearProgram3Fallbacks_(0), profileNo_(0), sim_(sim), id_(0)
+	{
+#if RVO_INSTRUMENTATION
+		statistics_ = NULL;
+#endif
+	}
+
+	void Agent::buildNeighborList()
+	{
+		const RVOSimulator::AgentProfile &profile = sim_->agentProfiles_[profileNo_];
+		const float skin = sim_->agentNeighborSkin_;
+
+		/*
+		 * The distance to the farthest of the agent neighbors of the previous
+		 * step, if there were enough of them, bounds the distance to the
+		 * present nearest neighbors. While no agent moves more than half the
+		 * skin, distances between agents change by at most the skin, so the
+		 * nearest neighbors of later steps are within that bound plus twice
+		 * the skin now, and in any case within the neighbor distance plus the
+		 * skin.
+		 */
+		float listRange = profile.neighborDist + skin;
+		float farthestNeighborDistSq = 0.0f;
+		size_t numActiveNeighbors = 0;
+
+		for (size_t i = 0; i < agentNeighbors_.size(); ++i) {
+			const size_t agentNo = agentNeighbors_[i].second;
+
+			if (sim_->agentActive_[agentNo]) {
+				farthestNeighborDistSq = std::max(farthestNeighborDistSq, absSq(sim_->agentPositions_[id_] - sim_->agentPositions_[agentNo]));
+				++numActiveNeighbors;
+			}
+		}
+
+		if (numActiveNeighbors == profile.maxNeighbors) {
+			listRange = std::min(listRange, std::sqrt(farthestNeighborDistSq) + 2.0f * skin);
+		}
+
+		neighborList_.clear();
+		buildingNeighborList_ = true;
+
+		float rangeSq = sqr(listRange);
+		sim_->agentNeighborIndex_->computeAgentNeighbors(this, rangeSq);
+
+		buildingNeighborList_ = false;
+		neighborListValid_ = true;
+
+		std::sort(neighborList_.begin(), neighborList_.end());
+	}
+
+	void Agent::computeAgentORCALines(float invTimeHorizon)
+	{
+		const Vector2 &position = sim_->agentPositions_[id_];
+		const Vector2 &velocity = sim_->agentVelocities_[id_];
+		const float radius = sim_->agentRadii_[id_];
+
+		for (size_t i = 0; i < agentNeighbors_.size(); ++i) {
+			const size_t other = agentNeighbors_[i].second;
+
+			const Vector2 relativePosition = sim_->agentPositions_[other] - position;
+			const Vector2 relativeVelocity = velocity - sim_->agentVelocities_[other];
+			const float distSq = absSq(relativePosition);
+			const float combinedRadius = radius + sim_->agentRadii_[other];
+			const float combinedRadiusSq = sqr(combinedRadius);
+
+			Line line;
+			Vector2 u;
+
+			if (distSq > combinedRadiusSq) {
+				/* No collision. */
+				const Vector2 w = relativeVelocity - invTimeHorizon * relativePosition;
+				/* Vector from cutoff center to relative velocity. */
+				const float wLengthSq = absSq(w);
+
+				const float dotProduct1 = w * relativePosition;
+
+				if (dotProduct1 < 0.0f && sqr(dotProduct1) > combinedRadiusSq * wLengthSq) {
+					/* Project on cut-off circle. */
+					const float wLength = std::sqrt(wLengthSq);
+					const Vector2 unitW = w / wLength;
+
+					line.direction = Vector2(unitW.y(), -unitW.x());
+					u = (combinedRadius * invTimeHorizon - wLength) * unitW;
+				}
+				else {
+					/* Project on legs. */
+					const float leg = std::sqrt(distSq - combinedRadiusSq);
+
+					if (det(relativePosition, w) > 0.0f) {
+						/* Project on left leg. */
+						line.direction = Vector2(relativePosition.x() * leg - relativePosition.y() * combinedRadius, relativePosition.x() * combinedRadius + relativePosition.y() * leg) / distSq;
+					}
+					else {
+						/* Project on right leg. */
+						line.direction = -Vector2(relativePosition.x() * leg + relativePosition.y() * combinedRadius, -relativePosition.x() * combinedRadius + relativePosition.y() * leg) / distSq;
+					}
+
+					const float dotProduct2 = relativeVelocity * line.direction;
+
+					u = dotProduct2 * line.direction - relativeVelocity;
+				}
+			}
+			else {
+				/* Collision. Project on cut-off circle of time timeStep. */
+				const float invTimeStep = 1.0f / sim_->timeStep_;
+
+				/* Vector from cutoff center to relative velocity. */
+				const Vector2 w = relativeVelocity - invTimeStep * relativePosition;
+
+				const float wLength = abs(w);
+				const Vector2 unitW = w / wLength;
+
+				line.direction = Vector2(unitW.y(), -unitW.x());
+				u = (combinedRadius * invTimeStep - wLength) * unitW;
+			}
+
+			line.point = velocity + 0.5f * u;
+			orcaLines_.push_back(line);
+		}
+	}
+
+#if RVO_SSE
+	void Agent::computeAgentORCALinesSSE(float invTimeHorizon)
+	{
+		const Vector2 &position = sim_->agentPositions_[id_];
+		const Vector2 &velocity = sim_->agentVelocities_[id_];
+
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128 radius = _mm_set1_ps(sim_->agentRadii_[id_]);
+		const __m128 invTimeHorizon4 = _mm_set1_ps(invTimeHorizon);
+		const __m128 invTimeStep = _mm_set1_ps(1.0f / sim_->timeStep_);
+
+		const size_t numNeighbors = agentNeighbors_.size();
+
+		for (size_t i = 0; i < numNeighbors; i += 4) {
+			/*
+			 * Gather four neighbors into the lanes, repeating the last neighbor
+			 * in the unused lanes of the final group.
+			 */
+			const size_t numLanes = std::min(numNeighbors - i, static_cast<size_t>(4));
+			float px[4], py[4], vx[4], vy[4], r[4];
+
+			for (size_t j = 0; j < 4; ++j) {
+				const size_t other = agentNeighbors_[i + std::min(j, numLanes - 1)].second;
+				const Vector2 &otherPosition = sim_->agentPositions_[other];
+				const Vector2 &otherVelocity = sim_->agentVelocities_[other];
+
+				px[j] = otherPosition.x() - position.x();
+				py[j] = otherPosition.y() - position.y();
+				vx[j] = velocity.x() - otherVelocity.x();
+				vy[j] = velocity.y() - otherVelocity.y();
+				r[j] = sim_->agentRadii_[other];
+			}
+
+			const __m128 relativePositionX = _mm_loadu_ps(px);
+			const __m128 relativePositionY = _mm_loadu_ps(py);
+			const __m128 relativeVelocityX = _mm_loadu_ps(vx);
+			const __m128 relativeVelocityY = _mm_loadu_ps(vy);
+
+			const __m128 distSq = _mm_add_ps(_mm_mul_ps(relativePositionX, relativePositionX), _mm_mul_ps(relativePositionY, relativePositionY));
+			const __m128 combinedRadius = _mm_add_ps(radius, _mm_loadu_ps(r));
+			const __m128 combinedRadiusSq = _mm_mul_ps(combinedRadius, combinedRadius);
+
+			/*
+			 * Colliding neighbors project on the cut-off circle of time
+			 * timeStep, the others on the cut-off circle of time timeHorizon or
+			 * on the legs, so the center of the cut-off circle is selected per
+			 * lane.
+			 */
+			const __m128 collision = _mm_cmple_ps(distSq, combinedRadiusSq);
+			const __m128 invTime = selectSSE(collision, invTimeStep, invTimeHorizon4);
+
+			/* Vector from cutoff center to relative velocity. */
+			const __m128 wX = _mm_sub_ps(relativeVelocityX, _mm_mul_ps(invTime, relativePositionX));
+			const __m128 wY = _mm_sub_ps(relativeVelocityY, _mm_mul_ps(invTime, relativePositionY));
+			const __m128 wLengthSq = _mm_add_ps(_mm_mul_ps(wX, wX), _mm_mul_ps(wY, wY));
+
+			const __m128 dotProduct1 = _mm_add_ps(_mm_mul_ps(wX, relativePositionX), _mm_mul_ps(wY, relativePositionY));
+			const __m128 cutoff = _mm_or_ps(collision, _mm_and_ps(_mm_cmplt_ps(dotProduct1, zero), _mm_cmpgt_ps(_mm_mul_ps(dotProduct1, dotProduct1), _mm_mul_ps(combinedRadiusSq, wLengthSq))));
+
+			/* Project on cut-off circle. */
+			const __m128 wLength = _mm_sqrt_ps(wLengthSq);
+			const __m128 invWLength = _mm_div_ps(one, wLength);
+			const __m128 unitWX = _mm_mul_ps(wX, invWLength);
+			const __m128 unitWY = _mm_mul_ps(wY, invWLength);
+			const __m128 cutoffScale = _mm_sub_ps(_mm_mul_ps(combinedRadius, invTime), wLength);
+
+			/*
+			 * Project on legs. The right leg is the mirror image of the left
+			 * leg, so it uses the negated leg length.
+			 */
+			const __m128 leg = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(distSq, combinedRadiusSq), zero));
+			const __m128 leftLeg = _mm_cmpgt_ps(_mm_sub_ps(_mm_mul_ps(relativePositionX, wY), _mm_mul_ps(relativePositionY, wX)), zero);
+			const __m128 signedLeg = selectSSE(leftLeg, leg, _mm_xor_ps(leg, signBit));
+			const __m128 invDistSq = _mm_div_ps(one, distSq);
+			const __m128 legDirectionX = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(relativePositionX, signedLeg), _mm_mul_ps(relativePositionY, combinedRadius)), invDistSq);
+			const __m128 legDirectionY = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(relativePositionX, combinedRadius), _mm_mul_ps(relativePositionY, signedLeg)), invDistSq);
+			const __m128 dotProduct2 = _mm_add_ps(_mm_mul_ps(relativeVelocityX, legDirectionX), _mm_mul_ps(relativeVelocityY, legDirectionY));
+
+			const __m128 directionX = selectSSE(cutoff, unitWY, legDirectionX);
+			const __m128 directionY = selectSSE(cutoff, _mm_xor_ps(unitWX, signBit), legDirectionY);
+			const __m128 uX = selectSSE(cutoff, _mm_mul_ps(cutoffScale, unitWX), _mm_sub_ps(_mm_mul_ps(dotProduct2, legDirectionX), relativeVelocityX));
+			const __m128 uY = selectSSE(cutoff, _mm_mul_ps(cutoffScale, unitWY), _mm_sub_ps(_mm_mul_ps(dotProduct2, legDirectionY), relativeVelocityY));
+
+			float pointX[4], pointY[4], directionX4[4], directionY4[4];
+			_mm_storeu_ps(pointX, _mm_add_ps(_mm_set1_ps(velocity.x()), _mm_mul_ps(half, uX)));
+			_mm_storeu_ps(pointY, _mm_add_ps(_mm_set1_ps(velocity.y()), _mm_mul_ps(half, uY)));
+			_mm_storeu_ps(directionX4, directionX);
+			_mm_storeu_ps(directionY4, directionY);
+
+			for (size_t j = 0; j < numLanes; ++j) {
+				Line line;
+				line.point = Vector2(pointX[j], pointY[j]);
+				line.direction = Vector2(directionX4[j], directionY4[j]);
+				orcaLines_.push_back(line);
+			}
+		}
+	}
+#endif
 
 	void Agent::computeNeighbors()
 	{
+#if RVO_INSTRUMENTATION
+		const double startTime = getWallTime();
+#endif
+
+		const RVOSimulator::AgentProfile &profile = sim_->agentProfiles_[profileNo_];
+
 		obstacleNeighbors_.clear();
-		float rangeSq = sqr(timeHorizonObst_ * maxSpeed_ + radius_);
+		float rangeSq = sqr(profile.timeHorizonObst * profile.maxSpeed + sim_->agentRadii_[id_]);
 		sim_->kdTree_->computeObstacleNeighbors(this, rangeSq);
+		sim_->obstacleGrid_->computeObstacleNeighbors(this, rangeSq);
+
+		if (profile.maxNeighbors > 0 && sim_->agentNeighborSkin_ > 0.0f && sim_->rebuildNeighborLists_) {
+			buildNeighborList();
+		}
 
 		agentNeighbors_.clear();
 
-		if (maxNeighbors_ > 0) {
-			rangeSq = sqr(neighborDist_);
-			sim_->kdTree_->computeAgentNeighbors(this, rangeSq);
+		if (profile.maxNeighbors > 0) {
+			rangeSq = sqr(profile.neighborDist);
+
+			if (sim_->agentNeighborSkin_ > 0.0f && neighborListValid_) {
+				/*
+				 * The list is sorted by distance when it was built, and the
+				 * present distances differ from those by at most the skin, so
+				 * the remaining agents are out of range once the distance
+				 * when the list was built exceeds the range plus the skin.
+				 */
+				const float skin = sim_->agentNeighborSkin_;
+				float maxListDist = profile.neighborDist + skin + RVO_EPSILON;
+
+				for (size_t i = 0; i < neighborList_.size() && neighborList_[i].first <= maxListDist; ++i) {
+					const float prevRangeSq = rangeSq;
+					insertAgentNeighbor(neighborList_[i].second, rangeSq);
+
+					if (rangeSq != prevRangeSq) {
+						maxListDist = std::sqrt(rangeSq) + skin + RVO_EPSILON;
+					}
+				}
+			}
+#if RVO_FIXED_MAX_NEIGHBORS
+			else if (profile.maxNeighbors == RVO_FIXED_MAX_NEIGHBORS) {
+				FixedAgentNeighbors<RVO_FIXED_MAX_NEIGHBORS> neighbors(&sim_->agentPositions_[0], sim_->deterministic_ ? &sim_->agentNumbers_[0] : NULL, id_);
+				sim_->agentNeighborIndex_->computeFixedAgentNeighbors(this, neighbors, rangeSq);
+
+				for (size_t i = 0; i < neighbors.numNeighbors_; ++i) {
+					agentNeighbors_.push_back(std::make_pair(neighbors.distSq_[i], neighbors.agentNos_[i]));
+				}
+			}
+#endif
+			else {
+				sim_->agentNeighborIndex_->computeAgentNeighbors(this, rangeSq);
+			}
 		}
+
+#if RVO_INSTRUMENTATION
+		statistics_->phaseTimes[RVO_PHASE_COMPUTE_NEIGHBORS] += getWallTime() - startTime;
+		statistics_->numAgentNeighbors += agentNeighbors_.size();
+		statistics_->numObstacleNeighbors += obstacleNeighbors_.size();
+#endif
 	}
 
 	/* Search for the best new velocity. */
 	void Agent::computeNewVelocity()
 	{
+#if RVO_INSTRUMENTATION
+		double startTime = getWallTime();
+		double endTime = 0.0;
+#endif
+
 		orcaLines_.clear();
 
-		const float invTimeHorizonObst = 1.0f / timeHorizonObst_;
+		const Vector2 &position = sim_->agentPositions_[id_];
+		const Vector2 &velocity = sim_->agentVelocities_[id_];
+		const float radius = sim_->agentRadii_[id_];
+		const RVOSimulator::AgentProfile &profile = sim_->agentProfiles_[profileNo_];
+		const float maxSpeed = profile.maxSpeed;
+
+		const float invTimeHorizonObst = 1.0f / profile.timeHorizonObst;
 
 		/* Create obstacle ORCA lines. */
 		for (size_t i = 0; i < obstacleNeighbors_.size(); ++i) {
@@ -65,8 +361,8 @@ namespace RVO {
 			const Obstacle *obstacle1 = obstacleNeighbors_[i].second;
 			const Obstacle *obstacle2 = obstacle1->nextObstacle_;
 
-			const Vector2 relativePosition1 = obstacle1->point_ - position_;
-			const Vector2 relativePosition2 = obstacle2->point_ - position_;
+			const Vector2 relativePosition1 = obstacle1->point_ - position;
+			const Vector2 relativePosition2 = obstacle2->point_ - position;
 
 			/*
 			 * Check if velocity obstacle of obstacle is already taken care of by
@@ -75,7 +371,7 @@ namespace RVO {
 			bool alreadyCovered = false;
 
 			for (size_t j = 0; j < orcaLines_.size(); ++j) {
-				if (det(invTimeHorizonObst * relativePosition1 - orcaLines_[j].point, orcaLines_[j].direction) - invTimeHorizonObst * radius_ >= -RVO_EPSILON && det(invTimeHorizonObst * relativePosition2 - orcaLines_[j].point, orcaLines_[j].direction) - invTimeHorizonObst * radius_ >=  -RVO_EPSILON) {
+				if (det(invTimeHorizonObst * relativePosition1 - orcaLines_[j].point, orcaLines_[j].direction) - invTimeHorizonObst * radius >= -RVO_EPSILON && det(invTimeHorizonObst * relativePosition2 - orcaLines_[j].point, orcaLines_[j].direction) - invTimeHorizonObst * radius >=  -RVO_EPSILON) {
 					alreadyCovered = true;
 					break;
 				}
@@ -90,7 +386,7 @@ namespace RVO {
 			const float distSq1 = absSq(relativePosition1);
 			const float distSq2 = absSq(relativePosition2);
 
-			const float radiusSq = sqr(radius_);
+			const float radiusSq = sqr(radius);
 
 			const Vector2 obstacleVector = obstacle2->point_ - obstacle1->point_;
 			const float s = (-relativePosition1 * obstacleVector) / absSq(obstacleVector);
@@ -148,8 +444,8 @@ namespace RVO {
 				obstacle2 = obstacle1;
 
 				const float leg1 = std::sqrt(distSq1 - radiusSq);
-				leftLegDirection = Vector2(relativePosition1.x() * leg1 - relativePosition1.y() * radius_, relativePosition1.x() * radius_ + relativePosition1.y() * leg1) / distSq1;
-				rightLegDirection = Vector2(relativePosition1.x() * leg1 + relativePosition1.y() * radius_, -relativePosition1.x() * radius_ + relativePosition1.y() * leg1) / distSq1;
+				leftLegDirection = Vector2(relativePosition1.x() * leg1 - relativePosition1.y() * radius, relativePosition1.x() * radius + relativePosition1.y() * leg1) / distSq1;
+				rightLegDirection = Vector2(relativePosition1.x() * leg1 + relativePosition1.y() * radius, -relativePosition1.x() * radius + relativePosition1.y() * leg1) / distSq1;
 			}
 			else if (s > 1.0f && distSqLine <= radiusSq) {
 				/*
@@ -164,14 +460,14 @@ namespace RVO {
 				obstacle1 = obstacle2;
 
 				const float leg2 = std::sqrt(distSq2 - radiusSq);
-				leftLegDirection = Vector2(relativePosition2.x() * leg2 - relativePosition2.y() * radius_, relativePosition2.x() * radius_ + relativePosition2.y() * leg2) / distSq2;
-				rightLegDirection = Vector2(relativePosition2.x() * leg2 + relativePosition2.y() * radius_, -relativePosition2.x() * radius_ + relativePosition2.y() * leg2) / distSq2;
+				leftLegDirection = Vector2(relativePosition2.x() * leg2 - relativePosition2.y() * radius, relativePosition2.x() * radius + relativePosition2.y() * leg2) / distSq2;
+				rightLegDirection = Vector2(relativePosition2.x() * leg2 + relativePosition2.y() * radius, -relativePosition2.x() * radius + relativePosition2.y() * leg2) / distSq2;
 			}
 			else {
 				/* Usual situation. */
 				if (obstacle1->isConvex_) {
 					const float leg1 = std::sqrt(distSq1 - radiusSq);
-					leftLegDirection = Vector2(relativePosition1.x() * leg1 - relativePosition1.y() * radius_, relativePosition1.x() * radius_ + relativePosition1.y() * leg1) / distSq1;
+					leftLegDirection = Vector2(relativePosition1.x() * leg1 - relativePosition1.y() * radius, relativePosition1.x() * radius + relativePosition1.y() * leg1) / distSq1;
 				}
 				else {
 					/* Left vertex non-convex; left leg extends cut-off line. */
@@ -180,7 +476,7 @@ namespace RVO {
 
 				if (obstacle2->isConvex_) {
 					const float leg2 = std::sqrt(distSq2 - radiusSq);
-					rightLegDirection = Vector2(relativePosition2.x() * leg2 + relativePosition2.y() * radius_, -relativePosition2.x() * radius_ + relativePosition2.y() * leg2) / distSq2;
+					rightLegDirection = Vector2(relativePosition2.x() * leg2 + relativePosition2.y() * radius, -relativePosition2.x() * radius + relativePosition2.y() * leg2) / distSq2;
 				}
 				else {
 					/* Right vertex non-convex; right leg extends cut-off line. */
@@ -212,32 +508,32 @@ namespace RVO {
 			}
 
 			/* Compute cut-off centers. */
-			const Vector2 leftCutoff = invTimeHorizonObst * (obstacle1->point_ - position_);
-			const Vector2 rightCutoff = invTimeHorizonObst * (obstacle2->point_ - position_);
+			const Vector2 leftCutoff = invTimeHorizonObst * (obstacle1->point_ - position);
+			const Vector2 rightCutoff = invTimeHorizonObst * (obstacle2->point_ - position);
 			const Vector2 cutoffVec = rightCutoff - leftCutoff;
 
 			/* Project current velocity on velocity obstacle. */
 
 			/* Check if current velocity is projected on cutoff circles. */
-			const float t = (obstacle1 == obstacle2 ? 0.5f : ((velocity_ - leftCutoff) * cutoffVec) / absSq(cutoffVec));
-			const float tLeft = ((velocity_ - leftCutoff) * leftLegDirection);
-			const float tRight = ((velocity_ - rightCutoff) * rightLegDirection);
+			const float t = (obstacle1 == obstacle2 ? 0.5f : ((velocity - leftCutoff) * cutoffVec) / absSq(cutoffVec));
+			const float tLeft = ((velocity - leftCutoff) * leftLegDirection);
+			const float tRight = ((velocity - rightCutoff) * rightLegDirection);
 
 			if ((t < 0.0f && tLeft < 0.0f) || (obstacle1 == obstacle2 && tLeft < 0.0f && tRight < 0.0f)) {
 				/* Project on left cut-off circle. */
-				const Vector2 unitW = normalize(velocity_ - leftCutoff);
+				const Vector2 unitW = normalize(velocity - leftCutoff);
 
 				line.direction = Vector2(unitW.y(), -unitW.x());
-				line.point = leftCutoff + radius_ * invTimeHorizonObst * unitW;
+				line.point = leftCutoff + radius * invTimeHorizonObst * unitW;
 				orcaLines_.push_back(line);
 				continue;
 			}
 			else if (t > 1.0f && tRight < 0.0f) {
 				/* Project on right cut-off circle. */
-				const Vector2 unitW = normalize(velocity_ - rightCutoff);
+				const Vector2 unitW = normalize(velocity - rightCutoff);
 
 				line.direction = Vector2(unitW.y(), -unitW.x());
-				line.point = rightCutoff + radius_ * invTimeHorizonObst * unitW;
+				line.point = rightCutoff + radius * invTimeHorizonObst * unitW;
 				orcaLines_.push_back(line);
 				continue;
 			}
@@ -246,14 +542,14 @@ namespace RVO {
 			 * Project on left leg, right leg, or cut-off line, whichever is closest
 			 * to velocity.
 			 */
-			const float distSqCutoff = ((t < 0.0f || t > 1.0f || obstacle1 == obstacle2) ? std::numeric_limits<float>::infinity() : absSq(velocity_ - (leftCutoff + t * cutoffVec)));
-			const float distSqLeft = ((tLeft < 0.0f) ? std::numeric_limits<float>::infinity() : absSq(velocity_ - (leftCutoff + tLeft * leftLegDirection)));
-			const float distSqRight = ((tRight < 0.0f) ? std::numeric_limits<float>::infinity() : absSq(velocity_ - (rightCutoff + tRight * rightLegDirection)));
+			const float distSqCutoff = ((t < 0.0f || t > 1.0f || obstacle1 == obstacle2) ? std::numeric_limits<float>::infinity() : absSq(velocity - (leftCutoff + t * cutoffVec)));
+			const float distSqLeft = ((tLeft < 0.0f) ? std::numeric_limits<float>::infinity() : absSq(velocity - (leftCutoff + tLeft * leftLegDirection)));
+			const float distSqRight = ((tRight < 0.0f) ? std::numeric_limits<float>::infinity() : absSq(velocity - (rightCutoff + tRight * rightLegDirection)));
 
 			if (distSqCutoff <= distSqLeft && distSqCutoff <= distSqRight) {
 				/* Project on cut-off line. */
 				line.direction = -obstacle1->unitDir_;
-				line.point = leftCutoff + radius_ * invTimeHorizonObst * Vector2(-line.direction.y(), line.direction.x());
+				line.point = leftCutoff + radius * invTimeHorizonObst * Vector2(-line.direction.y(), line.direction.x());
 				orcaLines_.push_back(line);
 				continue;
 			}
@@ -264,7 +560,7 @@ namespace RVO {
 				}
 
 				line.direction = leftLegDirection;
-				line.point = leftCutoff + radius_ * invTimeHorizonObst * Vector2(-line.direction.y(), line.direction.x());
+				line.point = leftCutoff + radius * invTimeHorizonObst * Vector2(-line.direction.y(), line.direction.x());
 				orcaLines_.push_back(line);
 				continue;
 			}
@@ -275,7 +571,7 @@ namespace RVO {
 				}
 
 				line.direction = -rightLegDirection;
-				line.point = rightCutoff + radius_ * invTimeHorizonObst * Vector2(-line.direction.y(), line.direction.x());
+				line.point = rightCutoff + radius * invTimeHorizonObst * Vector2(-line.direction.y(), line.direction.x());
 				orcaLines_.push_back(line);
 				continue;
 			}
@@ -283,100 +579,98 @@ namespace RVO {
 
 		const size_t numObstLines = orcaLines_.size();
 
-		const float invTimeHorizon = 1.0f / timeHorizon_;
-
-		/* Create agent ORCA lines. */
-		for (size_t i = 0; i < agentNeighbors_.size(); ++i) {
-			const Agent *const other = agentNeighbors_[i].second;
-
-			const Vector2 relativePosition = other->position_ - position_;
-			const Vector2 relativeVelocity = velocity_ - other->velocity_;
-			const float distSq = absSq(relativePosition);
-			const float combinedRadius = radius_ + other->radius_;
-			const float combinedRadiusSq = sqr(combinedRadius);
-
-			Line line;
-			Vector2 u;
-
-			if (distSq > combinedRadiusSq) {
-				/* No collision. */
-				const Vector2 w = relativeVelocity - invTimeHorizon * relativePosition;
-				/* Vector from cutoff center to relative velocity. */
-				const float wLengthSq = absSq(w);
+#if RVO_INSTRUMENTATION
+		endTime = getWallTime();
+		statistics_->phaseTimes[RVO_PHASE_OBSTACLE_ORCA_LINES] += endTime - startTime;
+		startTime = endTime;
+#endif
 
-				const float dotProduct1 = w * relativePosition;
+		const float invTimeHorizon = 1.0f / profile.timeHorizon;
 
-				if (dotProduct1 < 0.0f && sqr(dotProduct1) > combinedRadiusSq * wLengthSq) {
-					/* Project on cut-off circle. */
-					const float wLength = std::sqrt(wLengthSq);
-					const Vector2 unitW = w / wLength;
+		/* Create agent ORCA lines. */
+#if RVO_SSE
+		computeAgentORCALinesSSE(invTimeHorizon);
+#else
+		computeAgentORCALines(invTimeHorizon);
+#endif
+
+#if RVO_INSTRUMENTATION
+		endTime = getWallTime();
+		statistics_->phaseTimes[RVO_PHASE_AGENT_ORCA_LINES] += endTime - startTime;
+		startTime = endTime;
+#endif
+
+		const Line *const lines = orcaLines_.empty() ? NULL : &orcaLines_[0];
+		const size_t numLines = orcaLines_.size();
+
+		size_t lineFail = linearProgram2(lines, numLines, maxSpeed, sim_->agentPrefVelocities_[id_], false, newVelocity_);
+
+#if RVO_INSTRUMENTATION
+		endTime = getWallTime();
+		statistics_->phaseTimes[RVO_PHASE_LINEAR_PROGRAM_2] += endTime - startTime;
+		startTime = endTime;
+#endif
+
+		if (lineFail < numLines) {
+			/*
+			 * The projected lines never outnumber the ORCA lines, so the scratch
+			 * buffer only grows along with the ORCA line buffer.
+			 */
+			if (projLines_.size() < numLines) {
+				projLines_.resize(orcaLines_.capacity());
+			}
 
-					line.direction = Vector2(unitW.y(), -unitW.x());
-					u = (combinedRadius * invTimeHorizon - wLength) * unitW;
-				}
-				else {
-					/* Project on legs. */
-					const float leg = std::sqrt(distSq - combinedRadiusSq);
+			linearProgram3(lines, numLines, numObstLines, lineFail, maxSpeed, &projLines_[0], newVelocity_);
+			++numLinearProgram3Fallbacks_;
 
-					if (det(relativePosition, w) > 0.0f) {
-						/* Project on left leg. */
-						line.direction = Vector2(relativePosition.x() * leg - relativePosition.y() * combinedRadius, relativePosition.x() * combinedRadius + relativePosition.y() * leg) / distSq;
-					}
-					else {
-						/* Project on right leg. */
-						line.direction = -Vector2(relativePosition.x() * leg + relativePosition.y() * combinedRadius, -relativePosition.x() * combinedRadius + relativePosition.y() * leg) / distSq;
-					}
+#if RVO_INSTRUMENTATION
+			statistics_->phaseTimes[RVO_PHASE_LINEAR_PROGRAM_3] += getWallTime() - startTime;
+			++statistics_->numLinearProgram3Fallbacks;
+#endif
+		}
+	}
 
-					const float dotProduct2 = relativeVelocity * line.direction;
+	void Agent::insertAgentNeighbor(size_t agentNo, float &rangeSq)
+	{
+		if (id_ != agentNo) {
+			const float distSq = absSq(sim_->agentPositions_[id_] - sim_->agentPositions_[agentNo]);
 
-					u = dotProduct2 * line.direction - relativeVelocity;
+			if (buildingNeighborList_) {
+				if (distSq < rangeSq) {
+					neighborList_.push_back(std::make_pair(std::sqrt(distSq), agentNo));
 				}
-			}
-			else {
-				/* Collision. Project on cut-off circle of time timeStep. */
-				const float invTimeStep = 1.0f / sim_->timeStep_;
-
-				/* Vector from cutoff center to relative velocity. */
-				const Vector2 w = relativeVelocity - invTimeStep * relativePosition;
 
-				const float wLength = abs(w);
-				const Vector2 unitW = w / wLength;
-
-				line.direction = Vector2(unitW.y(), -unitW.x());
-				u = (combinedRadius * invTimeStep - wLength) * unitW;
+				return;
 			}
 
-			line.point = velocity_ + 0.5f * u;
-			orcaLines_.push_back(line);
-		}
-
-		size_t lineFail = linearProgram2(orcaLines_, maxSpeed_, prefVelocity_, false, newVelocity_);
-
-		if (lineFail < orcaLines_.size()) {
-			linearProgram3(orcaLines_, numObstLines, lineFail, maxSpeed_, newVelocity_);
-		}
-	}
-
-	void Agent::insertAgentNeighbor(const Agent *agent, float &rangeSq)
-	{
-		if (this != agent) {
-			const float distSq = absSq(position_ - agent->position_);
+			const size_t maxNeighbors = sim_->agentProfiles_[profileNo_].maxNeighbors;
 
-			if (distSq < rangeSq) {
-				if (agentNeighbors_.size() < maxNeighbors_) {
-					agentNeighbors_.push_back(std::make_pair(distSq, agent));
+			/*
+			 * In deterministic mode, an agent at the distance of the farthest of
+			 * a full set of neighbors still replaces it if its number is lower.
+			 */
+			if (distSq < rangeSq || (sim_->deterministic_ && distSq == rangeSq && agentNeighbors_.size() == maxNeighbors && sim_->agentNumbers_[agentNo] < sim_->agentNumbers_[agentNeighbors_.back().second])) {
+				if (agentNeighbors_.size() < maxNeighbors) {
+					agentNeighbors_.push_back(std::make_pair(distSq, agentNo));
 				}
 
+				/*
+				 * The neighbors are kept sorted by insertion even for a large
+				 * maximum number of neighbors. The queries visit the nearest
+				 * nodes first, so most agents are inserted near the end of the
+				 * set, and a bounded max-heap sorted once per query was slower
+				 * for up to 200 neighbors.
+				 */
 				size_t i = agentNeighbors_.size() - 1;
 
-				while (i != 0 && distSq < agentNeighbors_[i - 1].first) {
+				while (i != 0 && (distSq < agentNeighbors_[i - 1].first || (sim_->deterministic_ && distSq == agentNeighbors_[i - 1].first && sim_->agentNumbers_[agentNo] < sim_->agentNumbers_[agentNeighbors_[i - 1].second]))) {
 					agentNeighbors_[i] = agentNeighbors_[i - 1];
 					--i;
 				}
 
-				agentNeighbors_[i] = std::make_pair(distSq, agent);
+				agentNeighbors_[i] = std::make_pair(distSq, agentNo);
 
-				if (agentNeighbors_.size() == maxNeighbors_) {
+				if (agentNeighbors_.size() == maxNeighbors) {
 					rangeSq = agentNeighbors_.back().first;
 				}
 			}
@@ -387,7 +681,7 @@ namespace RVO {
 	{
 		const Obstacle *const nextObstacle = obstacle->nextObstacle_;
 
-		const float distSq = distSqPointLineSegment(obstacle->point_, nextObstacle->point_, position_);
+		const float distSq = distSqPointLineSegment(obstacle->point_, nextObstacle->point_, sim_->agentPositions_[id_]);
 
 		if (distSq < rangeSq) {
 			obstacleNeighbors_.push_back(std::make_pair(distSq, obstacle));
@@ -405,11 +699,11 @@ namespace RVO {
 
 	void Agent::update()
 	{
-		velocity_ = newVelocity_;
-		position_ += velocity_ * sim_->timeStep_;
+		sim_->agentVelocities_[id_] = newVelocity_;
+		sim_->agentPositions_[id_] += newVelocity_ * sim_->timeStep_;
 	}
 
-	bool linearProgram1(const std::vector<Line> &lines, size_t lineNo, float radius, const Vector2 &optVelocity, bool directionOpt, Vector2 &result)
+	bool linearProgram1(const Line *lines, size_t lineNo, float radius, const Vector2 &optVelocity, bool directionOpt, Vector2 &result)
 	{
 		const float dotProduct = lines[lineNo].point * lines[lineNo].direction;
 		const float discriminant = sqr(dotProduct) + sqr(radius) - absSq(lines[lineNo].point);
@@ -482,7 +776,7 @@ namespace RVO {
 		return true;
 	}
 
-	size_t linearProgram2(const std::vector<Line> &lines, float radius, const Vector2 &optVelocity, bool directionOpt, Vector2 &result)
+	size_t linearProgram2(const Line *lines, size_t numLines, float radius, const Vector2 &optVelocity, bool directionOpt, Vector2 &result)
 	{
 		if (directionOpt) {
 			/*
@@ -500,7 +794,7 @@ namespace RVO {
 			result = optVelocity;
 		}
 
-		for (size_t i = 0; i < lines.size(); ++i) {
+		for (size_t i = 0; i < numLines; ++i) {
 			if (det(lines[i].direction, lines[i].point - result) > 0.0f) {
 				/* Result does not satisfy constraint i. Compute new optimal result. */
 				const Vector2 tempResult = result;
@@ -512,17 +806,20 @@ namespace RVO {
 			}
 		}
 
-		return lines.size();
+		return numLines;
 	}
 
-	void linearProgram3(const std::vector<Line> &lines, size_t numObstLines, size_t beginLine, float radius, Vector2 &result)
+	void linearProgram3(const Line *lines, size_t numLines, size_t numObstLines, size_t beginLine, float radius, Line *projLines, Vector2 &result)
 	{
 		float distance = 0.0f;
 
-		for (size_t i = beginLine; i < lines.size(); ++i) {
+		/* The obstacle lines are the same for every projected linear program. */
+		std::copy(lines, lines + numObstLines, projLines);
+
+		for (size_t i = beginLine; i < numLines; ++i) {
 			if (det(lines[i].direction, lines[i].point - result) > distance) {
 				/* Result does not satisfy constraint of line i. */
-				std::vector<Line> projLines(lines.begin(), lines.begin() + static_cast<ptrdiff_t>(numObstLines));
+				size_t numProjLines = numObstLines;
 
 				for (size_t j = numObstLines; j < i; ++j) {
 					Line line;
@@ -545,12 +842,12 @@ namespace RVO {
 					}
 
 					line.direction = normalize(lines[j].direction - lines[i].direction);
-					projLines.push_back(line);
+					projLines[numProjLines++] = line;
 				}
 
 				const Vector2 tempResult = result;
 
-				if (linearProgram2(projLines, radius, Vector2(-lines[i].direction.y(), lines[i].direction.x()), true, result) < projLines.size()) {
+				if (linearProgram2(projLines, numProjLines, radius, Vector2(-lines[i].direction.y(), lines[i].direction.x()), true, result) < numProjLines) {
 					/* This should in principle not happen.  The result is by definition
 					 * already in the feasible region of this linear program. If it fails,
 					 * it is due to small floating point error, and the current result is
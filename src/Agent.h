@@ -53,6 +53,29 @@ namespace RVO {
 		 */
 		explicit Agent(RVOSimulator *sim);
 
+		/**
+		 * \brief      Builds the agent neighbor list of this agent, the agents
+		 *             that can be among its nearest agent neighbors until the
+		 *             lists are rebuilt.
+		 */
+		void buildNeighborList();
+
+		/**
+		 * \brief      Computes the ORCA lines of this agent induced by its agent
+		 *             neighbors.
+		 * \param      invTimeHorizon  The inverse of the time horizon.
+		 */
+		void computeAgentORCALines(float invTimeHorizon);
+
+#if RVO_SSE
+		/**
+		 * \brief      Computes the ORCA lines of this agent induced by its agent
+		 *             neighbors, four neighbors at a time using SSE2 lanes.
+		 * \param      invTimeHorizon  The inverse of the time horizon.
+		 */
+		void computeAgentORCALinesSSE(float invTimeHorizon);
+
+#endif
 		/**
 		 * \brief      Computes the neighbors of this agent.
 		 */
@@ -65,11 +88,12 @@ namespace RVO {
 
 		/**
 		 * \brief      Inserts an agent neighbor into the set of neighbors of
-		 *             this agent.
-		 * \param      agent           A pointer to the agent to be inserted.
+		 *             this agent, or into its agent neighbor list while the list
+		 *             is being built.
+		 * \param      agentNo         The number of the agent to be inserted.
 		 * \param      rangeSq         The squared range around this agent.
 		 */
-		void insertAgentNeighbor(const Agent *agent, float &rangeSq);
+		void insertAgentNeighbor(size_t agentNo, float &rangeSq);
 
 		/**
 		 * \brief      Inserts a static obstacle neighbor into the set of neighbors
@@ -86,25 +110,35 @@ namespace RVO {
 		 */
 		void update();
 
-		std::vector<std::pair<float, const Agent *> > agentNeighbors_;
-		size_t maxNeighbors_;
-		float maxSpeed_;
-		float neighborDist_;
+		/*
+		 * Position, velocity, preferred velocity and radius are stored in the
+		 * structure-of-arrays agent storage of the simulator, indexed by id_;
+		 * maximum neighbor count, maximum speed, neighbor distance and time
+		 * horizons in the profile of the agent, indexed by profileNo_.
+		 */
+		std::vector<std::pair<float, size_t> > agentNeighbors_;
+		bool buildingNeighborList_;
+		std::vector<std::pair<float, size_t> > neighborList_;
+		bool neighborListValid_;
 		Vector2 newVelocity_;
+		size_t numLinearProgram3Fallbacks_;
 		std::vector<std::pair<float, const Obstacle *> > obstacleNeighbors_;
 		std::vector<Line> orcaLines_;
-		Vector2 position_;
-		Vector2 prefVelocity_;
-		float radius_;
+		size_t profileNo_;
+		std::vector<Line> projLines_;
 		RVOSimulator *sim_;
-		float timeHorizon_;
-		float timeHorizonObst_;
-		Vector2 velocity_;
+#if RVO_INSTRUMENTATION
+		StepStatistics *statistics_;
+#endif
 
 		size_t id_;
 
+		friend class ApproachingAgents;
 		friend class KdTree;
+		friend class NavigationField;
+		friend class ObstacleGrid;
 		friend class RVOSimulator;
+		friend class SpatialHash;
 	};
 
 	/**
@@ -120,7 +154,7 @@ namespace RVO {
 	 * \param      result        A reference to the result of the linear program.
 	 * \return     True if successful.
 	 */
-	bool linearProgram1(const std::vector<Line> &lines, size_t lineNo,
+	bool linearProgram1(const Line *lines, size_t lineNo,
 						float radius, const Vector2 &optVelocity,
 						bool directionOpt, Vector2 &result);
 
@@ -129,13 +163,14 @@ namespace RVO {
 	 * \brief      Solves a two-dimensional linear program subject to linear
 	 *             constraints defined by lines and a circular constraint.
 	 * \param      lines         Lines defining the linear constraints.
+	 * \param      numLines      Count of lines.
 	 * \param      radius        The radius of the circular constraint.
 	 * \param      optVelocity   The optimization velocity.
 	 * \param      directionOpt  True if the direction should be optimized.
 	 * \param      result        A reference to the result of the linear program.
 	 * \return     The number of the line it fails on, and the number of lines if successful.
 	 */
-	size_t linearProgram2(const std::vector<Line> &lines, float radius,
+	size_t linearProgram2(const Line *lines, size_t numLines, float radius,
 						  const Vector2 &optVelocity, bool directionOpt,
 						  Vector2 &result);
 
@@ -144,13 +179,17 @@ namespace RVO {
 	 * \brief      Solves a two-dimensional linear program subject to linear
 	 *             constraints defined by lines and a circular constraint.
 	 * \param      lines         Lines defining the linear constraints.
+	 * \param      numLines      Count of lines.
 	 * \param      numObstLines  Count of obstacle lines.
 	 * \param      beginLine     The line on which the 2-d linear program failed.
 	 * \param      radius        The radius of the circular constraint.
+	 * \param      projLines     Scratch buffer for the projected lines, with
+	 *                           room for at least numLines lines.
 	 * \param      result        A reference to the result of the linear program.
 	 */
-	void linearProgram3(const std::vector<Line> &lines, size_t numObstLines, size_t beginLine,
-						float radius, Vector2 &result);
+	void linearProgram3(const Line *lines, size_t numLines, size_t numObstLines,
+						size_t beginLine, float radius, Line *projLines,
+						Vector2 &result);
 }
 
 #endif /* RVO_AGENT_H_ */
@@ -0,0 +1,103 @@
+/*
+ * AgentNeighborIndex.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#ifndef RVO_AGENT_NEIGHBOR_INDEX_H_
+#define RVO_AGENT_NEIGHBOR_INDEX_H_
+
+/**
+ * \file       AgentNeighborIndex.h
+ * \brief      Contains the AgentNeighborIndex class.
+ */
+
+#include "Definitions.h"
+#include "FixedAgentNeighbors.h"
+
+namespace RVO {
+	/**
+	 * \brief      Defines the interface of the spatial data structures that
+	 *             answer agent neighbor queries in the simulation.
+	 */
+	class AgentNeighborIndex {
+	public:
+		/**
+		 * \brief      Destroys this agent neighbor index instance.
+		 */
+		virtual ~AgentNeighborIndex() { }
+
+	private:
+		/**
+		 * \brief      Builds the agent neighbor index for the current positions
+		 *             of the active agents.
+		 */
+		virtual void buildAgentIndex() = 0;
+
+		/**
+		 * \brief      Computes the agent neighbors of the specified agent.
+		 * \param      agent           A pointer to the agent for which agent
+		 *                             neighbors are to be computed.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		virtual void computeAgentNeighbors(Agent *agent,
+										   float &rangeSq) const = 0;
+
+		/**
+		 * \brief      Tests whether an awake agent moving faster than the sleep
+		 *             speed approaches the specified sleeping agent.
+		 * \param      agent           A pointer to the sleeping agent.
+		 * \param      agents          The test of the approaching agents.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		virtual void computeApproachingAgents(Agent *agent,
+											  ApproachingAgents &agents,
+											  float rangeSq) const = 0;
+
+#if RVO_FIXED_MAX_NEIGHBORS
+		/**
+		 * \brief      Computes the agent neighbors of the specified agent into
+		 *             a set with a maximum number of agent neighbors fixed at
+		 *             compile time.
+		 * \param      agent           A pointer to the agent for which agent
+		 *                             neighbors are to be computed.
+		 * \param      neighbors       The set of agent neighbors.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		virtual void computeFixedAgentNeighbors(Agent *agent,
+												FixedAgentNeighbors<RVO_FIXED_MAX_NEIGHBORS> &neighbors,
+												float &rangeSq) const = 0;
+
+#endif
+		friend class Agent;
+		friend class RVOSimulator;
+	};
+}
+
+#endif /* RVO_AGENT_NEIGHBOR_INDEX_H_ */
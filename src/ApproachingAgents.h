@@ -0,0 +1,99 @@
+/*
+ * ApproachingAgents.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#ifndef RVO_APPROACHING_AGENTS_H_
+#define RVO_APPROACHING_AGENTS_H_
+
+/**
+ * \file       ApproachingAgents.h
+ * \brief      Contains the ApproachingAgents class.
+ */
+
+#include "Definitions.h"
+#include "Agent.h"
+
+namespace RVO {
+	/**
+	 * \brief      Defines a test of whether an awake agent that moves faster
+	 *             than the sleep speed approaches a sleeping agent within the
+	 *             neighbor distance of the sleeping agent.
+	 *
+	 * The agent neighbor indices query it like a set of agent neighbors, but it
+	 * tests every agent in range instead of keeping the nearest ones, so that
+	 * a moving agent wakes up a sleeping agent however many agents are closer
+	 * to either of them.
+	 */
+	class ApproachingAgents {
+	private:
+		/**
+		 * \brief      Constructs a test that no agent has passed yet.
+		 * \param      sim             The simulator instance.
+		 * \param      id              The index of the sleeping agent.
+		 * \param      sleepSpeedSq    The squared sleep speed.
+		 */
+		ApproachingAgents(const RVOSimulator *sim, size_t id, float sleepSpeedSq) : isApproached_(false), neighborDistSq_(sqr(sim->agentProfiles_[sim->agents_[id]->profileNo_].neighborDist)), position_(sim->agentPositions_[id]), sim_(sim), sleepSpeedSq_(sleepSpeedSq), id_(id) { }
+
+		/**
+		 * \brief      Tests whether an agent approaches the sleeping agent.
+		 * \param      agentNo         The index of the agent to be tested.
+		 * \param      rangeSq         The squared range of the query, cleared
+		 *                             once an agent approaches.
+		 */
+		void insertAgentNeighbor(size_t agentNo, float &rangeSq)
+		{
+			if (isApproached_ || agentNo == id_ || sim_->agentSleeping_[agentNo]) {
+				return;
+			}
+
+			const Vector2 relativePosition = position_ - sim_->agentPositions_[agentNo];
+			const Vector2 &velocity = sim_->agents_[agentNo]->newVelocity_;
+
+			if (absSq(relativePosition) < neighborDistSq_ && absSq(velocity) > sleepSpeedSq_ && velocity * relativePosition > 0.0f) {
+				isApproached_ = true;
+				rangeSq = 0.0f;
+			}
+		}
+
+		bool isApproached_;
+		float neighborDistSq_;
+		Vector2 position_;
+		const RVOSimulator *sim_;
+		float sleepSpeedSq_;
+		size_t id_;
+
+		friend class KdTree;
+		friend class RVOSimulator;
+		friend class SpatialHash;
+	};
+}
+
+#endif /* RVO_APPROACHING_AGENTS_H_ */
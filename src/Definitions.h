@@ -46,13 +46,53 @@
 
 #include "Vector2.h"
 
+/**
+ * \brief      Nonzero when each simulation step collects the timings and
+ *             counters of RVO::StepStatistics. Define RVO_INSTRUMENTATION as 1
+ *             when compiling the library to enable them; otherwise they are
+ *             compiled out.
+ */
+#ifndef RVO_INSTRUMENTATION
+#define RVO_INSTRUMENTATION 0
+#endif
+
+#if RVO_INSTRUMENTATION
+#include <chrono>
+#endif
+
 /**
  * \brief       A sufficiently small positive number.
  */
 const float RVO_EPSILON = 0.00001f;
 
+/**
+ * \brief      Nonzero when the agent ORCA lines are constructed with SSE2
+ *             instructions. Define RVO_NO_SSE to use the scalar construction.
+ */
+#ifndef RVO_SSE
+#if !defined(RVO_NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define RVO_SSE 1
+#else
+#define RVO_SSE 0
+#endif
+#endif
+
+/**
+ * \brief      The maximum number of agent neighbors for which the agent
+ *             neighbor queries use kernels specialized at compile time. Agents
+ *             with this maximum number of agent neighbors use them, also in
+ *             deterministic mode; other agents use the generic kernels, with
+ *             the same results. Define RVO_FIXED_MAX_NEIGHBORS as the maximum
+ *             number of agent neighbors of the simulation when compiling the
+ *             library, or as 0 to compile only the generic kernels.
+ */
+#ifndef RVO_FIXED_MAX_NEIGHBORS
+#define RVO_FIXED_MAX_NEIGHBORS 10
+#endif
+
 namespace RVO {
 	class Agent;
+	class ApproachingAgents;
 	class Obstacle;
 	class RVOSimulator;
 
@@ -95,6 +135,17 @@ namespace RVO {
 		return det(a - c, b - a);
 	}
 
+#if RVO_INSTRUMENTATION
+	/**
+	 * \brief      Returns the wall time for instrumentation.
+	 * \return     The wall time in seconds since an arbitrary epoch.
+	 */
+	inline double getWallTime()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+#endif
 	/**
 	 * \brief      Computes the square of a float.
 	 * \param      a               The float to be squared.
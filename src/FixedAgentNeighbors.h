@@ -0,0 +1,120 @@
+/*
+ * FixedAgentNeighbors.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#ifndef RVO_FIXED_AGENT_NEIGHBORS_H_
+#define RVO_FIXED_AGENT_NEIGHBORS_H_
+
+/**
+ * \file       FixedAgentNeighbors.h
+ * \brief      Contains the FixedAgentNeighbors class.
+ */
+
+#include "Definitions.h"
+
+namespace RVO {
+	/**
+	 * \brief      Defines the nearest agent neighbors of an agent for a maximum
+	 *             number of agent neighbors that is fixed at compile time.
+	 *
+	 * The agent neighbor queries of the agent neighbor indices are templates
+	 * over the set into which they insert the agents. With this set, they are
+	 * compiled into kernels that keep the neighbors in fixed-size arrays on the
+	 * stack and inline the insertion into the traversal.
+	 */
+	template <size_t MAX_NEIGHBORS>
+	class FixedAgentNeighbors {
+	private:
+		/**
+		 * \brief      Constructs an empty set of agent neighbors.
+		 * \param      positions       The positions of the agents, indexed by
+		 *                             agent index.
+		 * \param      agentNumbers    The numbers of the agents, indexed by
+		 *                             agent index, in deterministic mode, or
+		 *                             NULL otherwise.
+		 * \param      id              The index of the agent whose agent
+		 *                             neighbors are to be computed.
+		 */
+		FixedAgentNeighbors(const Vector2 *positions, const size_t *agentNumbers, size_t id) : agentNumbers_(agentNumbers), numNeighbors_(0), position_(positions[id]), positions_(positions), id_(id) { }
+
+		/**
+		 * \brief      Inserts an agent neighbor into the set of neighbors, in
+		 *             the same order as Agent::insertAgentNeighbor.
+		 * \param      agentNo         The index of the agent to be inserted.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		void insertAgentNeighbor(size_t agentNo, float &rangeSq)
+		{
+			const float distSq = absSq(position_ - positions_[agentNo]);
+
+			/*
+			 * In deterministic mode, an agent at the distance of the farthest of
+			 * a full set of neighbors still replaces it if its number is lower.
+			 */
+			if (agentNo == id_ || !(distSq < rangeSq || (agentNumbers_ != NULL && distSq == rangeSq && numNeighbors_ == MAX_NEIGHBORS && agentNumbers_[agentNo] < agentNumbers_[agentNos_[MAX_NEIGHBORS - 1]]))) {
+				return;
+			}
+
+			size_t i = (numNeighbors_ < MAX_NEIGHBORS ? numNeighbors_ : MAX_NEIGHBORS - 1);
+
+			while (i != 0 && (distSq < distSq_[i - 1] || (agentNumbers_ != NULL && distSq == distSq_[i - 1] && agentNumbers_[agentNo] < agentNumbers_[agentNos_[i - 1]]))) {
+				agentNos_[i] = agentNos_[i - 1];
+				distSq_[i] = distSq_[i - 1];
+				--i;
+			}
+
+			agentNos_[i] = agentNo;
+			distSq_[i] = distSq;
+
+			if (numNeighbors_ < MAX_NEIGHBORS) {
+				++numNeighbors_;
+			}
+
+			if (numNeighbors_ == MAX_NEIGHBORS) {
+				rangeSq = distSq_[MAX_NEIGHBORS - 1];
+			}
+		}
+
+		size_t agentNos_[MAX_NEIGHBORS];
+		const size_t *agentNumbers_;
+		float distSq_[MAX_NEIGHBORS];
+		size_t numNeighbors_;
+		Vector2 position_;
+		const Vector2 *positions_;
+		size_t id_;
+
+		friend class Agent;
+		friend class KdTree;
+		friend class SpatialHash;
+	};
+}
+
+#endif /* RVO_FIXED_AGENT_NEIGHBORS_H_ */
@@ -33,44 +33,155 @@
 #include "KdTree.h"
 
 #include "Agent.h"
+#include "ApproachingAgents.h"
 #include "RVOSimulator.h"
 #include "Obstacle.h"
+#include "ThreadPool.h"
 
 namespace RVO {
-	KdTree::KdTree(RVOSimulator *sim) : obstacleTree_(NULL), sim_(sim) { }
+	namespace {
+		/*
+		 * An obstacle tree node whose near side is being visited, and the
+		 * signed distance of the agent to its line.
+		 */
+		struct ObstacleTreeStackEntry {
+			size_t node;
+			float agentLeftOfLine;
+		};
+
+		/*
+		 * An obstacle tree node that is to be visited by a packet of
+		 * visibility queries, and the mask of the queries that reach it.
+		 */
+		struct VisibilityPacketStackEntry {
+			size_t node;
+			unsigned int mask;
+		};
+
+		/* The explicit stacks of the obstacle tree queries of each thread. */
+		thread_local std::vector<ObstacleTreeStackEntry> obstacleTreeStack;
+		thread_local std::vector<VisibilityPacketStackEntry> visibilityPacketStack;
+		thread_local std::vector<size_t> visibilityStack;
+
+		/*
+		 * Returns the number of a single set bit of a 32-bit mask by de Bruijn
+		 * multiplication.
+		 */
+		inline size_t getBitNo(unsigned int bit)
+		{
+			static const unsigned char bitNos[32] = {
+				0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+				31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9
+			};
+
+			return bitNos[((bit * 0x077cb531u) & 0xffffffffu) >> 27];
+		}
+
+		/*
+		 * Returns the obstacle of the candidate splitter with the specified
+		 * number. All obstacles are candidates when there are few; otherwise,
+		 * the candidates follow a golden ratio sequence over the obstacles, so
+		 * that regular maps, such as grids of blocks, do not align the sample
+		 * with edges of a single orientation.
+		 */
+		size_t getSplitCandidate(size_t candidateNo, size_t numCandidates, size_t numObstacles)
+		{
+			if (numCandidates == numObstacles) {
+				return candidateNo;
+			}
+
+			const std::uint64_t fraction = static_cast<std::uint32_t>(candidateNo * 2654435769u);
+
+			return static_cast<size_t>((fraction * numObstacles) >> 32);
+		}
+	}
+
+	KdTree::KdTree(RVOSimulator *sim) : agentsChanged_(false), agentTreeCost_(0.0f), agentTreeRefitThreshold_(0.0f), sim_(sim) { }
+
+	KdTree::~KdTree() { }
+
+	void KdTree::buildAgentIndex()
+	{
+		buildAgentTree();
+	}
 
-	KdTree::~KdTree()
+	void KdTree::buildAgentSubtrees(size_t begin, size_t end)
 	{
-		deleteObstacleTree(obstacleTree_);
+		for (size_t i = begin; i < end; ++i) {
+			const size_t node = agentSubtrees_[i];
+
+			buildAgentTreeRecursive(agentTree_[node].begin, agentTree_[node].end, node);
+		}
 	}
 
 	void KdTree::buildAgentTree()
 	{
-		if (agents_.size() < sim_->agents_.size()) {
-			for (size_t i = agents_.size(); i < sim_->agents_.size(); ++i) {
-				agents_.push_back(sim_->agents_[i]);
+		bool rebuild = true;
+
+		if (agentsChanged_) {
+			/*
+			 * Drop inactive agents and append newly active ones, keeping the
+			 * spatially sorted order of the previous build for the others.
+			 */
+			std::vector<char> inTree(sim_->agents_.size(), 0);
+			size_t numAgents = 0;
+
+			for (size_t i = 0; i < agents_.size(); ++i) {
+				if (sim_->agentActive_[agents_[i]]) {
+					inTree[agents_[i]] = 1;
+					agents_[numAgents++] = agents_[i];
+				}
 			}
 
-			agentTree_.resize(2 * agents_.size() - 1);
+			agents_.resize(numAgents);
+
+			for (size_t i = 0; i < sim_->agents_.size(); ++i) {
+				if (sim_->agentActive_[i] && !inTree[i]) {
+					agents_.push_back(i);
+				}
+			}
+
+			agentTree_.resize(agents_.empty() ? 0 : 2 * agents_.size() - 1);
+			agentsChanged_ = false;
+		}
+		else if (agentTreeRefitThreshold_ > 0.0f && !agents_.empty()) {
+			/*
+			 * Agents move little per step, so the partition of the previous step
+			 * usually remains good. Keep it unless the refitted bounding boxes
+			 * degrade the tree by more than the threshold.
+			 */
+			refitAgentTreeRecursive(0);
+			rebuild = (computeAgentTreeCost() > (1.0f + agentTreeRefitThreshold_) * agentTreeCost_);
 		}
 
-		if (!agents_.empty()) {
-			buildAgentTreeRecursive(0, agents_.size(), 0);
+		if (rebuild && !agents_.empty()) {
+			if (agents_.size() >= 2 * MIN_PARALLEL_SUBTREE_SIZE && sim_->getNumWorkerThreads() > 1) {
+				buildAgentTreeParallel();
+			}
+			else {
+				buildAgentTreeRecursive(0, agents_.size(), 0);
+			}
+
+			if (agentTreeRefitThreshold_ > 0.0f) {
+				agentTreeCost_ = computeAgentTreeCost();
+			}
 		}
 	}
 
-	void KdTree::buildAgentTreeRecursive(size_t begin, size_t end, size_t node)
+	void KdTree::buildAgentTreeNode(size_t begin, size_t end, size_t node)
 	{
+		const std::vector<Vector2> &positions = sim_->agentPositions_;
+
 		agentTree_[node].begin = begin;
 		agentTree_[node].end = end;
-		agentTree_[node].minX = agentTree_[node].maxX = agents_[begin]->position_.x();
-		agentTree_[node].minY = agentTree_[node].maxY = agents_[begin]->position_.y();
+		agentTree_[node].minX = agentTree_[node].maxX = positions[agents_[begin]].x();
+		agentTree_[node].minY = agentTree_[node].maxY = positions[agents_[begin]].y();
 
 		for (size_t i = begin + 1; i < end; ++i) {
-			agentTree_[node].maxX = std::max(agentTree_[node].maxX, agents_[i]->position_.x());
-			agentTree_[node].minX = std::min(agentTree_[node].minX, agents_[i]->position_.x());
-			agentTree_[node].maxY = std::max(agentTree_[node].maxY, agents_[i]->position_.y());
-			agentTree_[node].minY = std::min(agentTree_[node].minY, agents_[i]->position_.y());
+			agentTree_[node].maxX = std::max(agentTree_[node].maxX, positions[agents_[i]].x());
+			agentTree_[node].minX = std::min(agentTree_[node].minX, positions[agents_[i]].x());
+			agentTree_[node].maxY = std::max(agentTree_[node].maxY, positions[agents_[i]].y());
+			agentTree_[node].minY = std::min(agentTree_[node].minY, positions[agents_[i]].y());
 		}
 
 		if (end - begin > MAX_LEAF_SIZE) {
@@ -82,11 +193,11 @@ namespace RVO {
 			size_t right = end;
 
 			while (left < right) {
-				while (left < right && (isVertical ? agents_[left]->position_.x() : agents_[left]->position_.y()) < splitValue) {
+				while (left < right && (isVertical ? positions[agents_[left]].x() : positions[agents_[left]].y()) < splitValue) {
 					++left;
 				}
 
-				while (right > left && (isVertical ? agents_[right - 1]->position_.x() : agents_[right - 1]->position_.y()) >= splitValue) {
+				while (right > left && (isVertical ? positions[agents_[right - 1]].x() : positions[agents_[right - 1]].y()) >= splitValue) {
 					--right;
 				}
 
@@ -104,15 +215,107 @@ namespace RVO {
 
 			agentTree_[node].left = node + 1;
 			agentTree_[node].right = node + 2 * (left - begin);
+		}
+	}
+
+	void KdTree::buildAgentTreeParallel()
+	{
+		/*
+		 * Split the largest subtree sequentially until there are enough
+		 * subtrees to balance among the threads. The node numbers only depend
+		 * on the partition, so the subtrees can then be built independently
+		 * into the same layout as the sequential build.
+		 */
+		const size_t numSubtrees = 4 * sim_->getNumWorkerThreads();
+
+		agentTree_[0].begin = 0;
+		agentTree_[0].end = agents_.size();
+
+		agentSubtrees_.assign(1, 0);
+
+		while (agentSubtrees_.size() < numSubtrees) {
+			size_t largest = 0;
+
+			for (size_t i = 1; i < agentSubtrees_.size(); ++i) {
+				if (agentTree_[agentSubtrees_[i]].end - agentTree_[agentSubtrees_[i]].begin > agentTree_[agentSubtrees_[largest]].end - agentTree_[agentSubtrees_[largest]].begin) {
+					largest = i;
+				}
+			}
+
+			const size_t node = agentSubtrees_[largest];
+			const size_t begin = agentTree_[node].begin;
+			const size_t end = agentTree_[node].end;
+
+			if (end - begin < 2 * MIN_PARALLEL_SUBTREE_SIZE) {
+				break;
+			}
+
+			buildAgentTreeNode(begin, end, node);
+
+			const size_t left = agentTree_[node].left;
+			const size_t right = agentTree_[node].right;
+			const size_t split = begin + (right - node) / 2;
 
-			buildAgentTreeRecursive(begin, left, agentTree_[node].left);
-			buildAgentTreeRecursive(left, end, agentTree_[node].right);
+			agentTree_[left].begin = begin;
+			agentTree_[left].end = split;
+			agentTree_[right].begin = split;
+			agentTree_[right].end = end;
+
+			agentSubtrees_[largest] = left;
+			agentSubtrees_.push_back(right);
+		}
+
+		if (sim_->threadPool_ != NULL) {
+			ThreadPool::MemberTask<KdTree, &KdTree::buildAgentSubtrees> task(this);
+			sim_->threadPool_->parallelFor(agentSubtrees_.size(), 1, task);
+		}
+		else {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int i = 0; i < static_cast<int>(agentSubtrees_.size()); ++i) {
+				buildAgentSubtrees(static_cast<size_t>(i), static_cast<size_t>(i) + 1);
+			}
+		}
+	}
+
+	void KdTree::buildAgentTreeRecursive(size_t begin, size_t end, size_t node)
+	{
+		buildAgentTreeNode(begin, end, node);
+
+		if (end - begin > MAX_LEAF_SIZE) {
+			const size_t split = begin + (agentTree_[node].right - node) / 2;
+
+			buildAgentTreeRecursive(begin, split, agentTree_[node].left);
+			buildAgentTreeRecursive(split, end, agentTree_[node].right);
+		}
+	}
+
+	float KdTree::computeAgentTreeCost() const
+	{
+		const float rootHalfPerimeter = agentTree_[0].maxX - agentTree_[0].minX + agentTree_[0].maxY - agentTree_[0].minY;
+
+		if (rootHalfPerimeter <= RVO_EPSILON) {
+			return 1.0f;
+		}
+
+		return computeAgentTreeCostRecursive(0) / rootHalfPerimeter;
+	}
+
+	float KdTree::computeAgentTreeCostRecursive(size_t node) const
+	{
+		const float halfPerimeter = agentTree_[node].maxX - agentTree_[node].minX + agentTree_[node].maxY - agentTree_[node].minY;
+
+		if (agentTree_[node].end - agentTree_[node].begin <= MAX_LEAF_SIZE) {
+			return halfPerimeter;
 		}
+
+		return halfPerimeter + computeAgentTreeCostRecursive(agentTree_[node].left) + computeAgentTreeCostRecursive(agentTree_[node].right);
 	}
 
 	void KdTree::buildObstacleTree()
 	{
-		deleteObstacleTree(obstacleTree_);
+		obstacleTree_.clear();
 
 		std::vector<Obstacle *> obstacles(sim_->obstacles_.size());
 
@@ -120,23 +323,31 @@ namespace RVO {
 			obstacles[i] = sim_->obstacles_[i];
 		}
 
-		obstacleTree_ = buildObstacleTreeRecursive(obstacles);
+		buildObstacleTreeRecursive(obstacles);
 	}
 
-
-	KdTree::ObstacleTreeNode *KdTree::buildObstacleTreeRecursive(const std::vector<Obstacle *> &obstacles)
+	size_t KdTree::buildObstacleTreeRecursive(const std::vector<Obstacle *> &obstacles)
 	{
 		if (obstacles.empty()) {
-			return NULL;
+			return RVO_ERROR;
 		}
 		else {
-			ObstacleTreeNode *const node = new ObstacleTreeNode;
+			const size_t node = obstacleTree_.size();
+			obstacleTree_.push_back(ObstacleTreeNode());
 
 			size_t optimalSplit = 0;
 			size_t minLeft = obstacles.size();
 			size_t minRight = obstacles.size();
 
-			for (size_t i = 0; i < obstacles.size(); ++i) {
+			/*
+			 * Evaluating every obstacle as splitter is quadratic in the number
+			 * of obstacles, so large nodes only evaluate a sample.
+			 */
+			const size_t numCandidates = (obstacles.size() < MAX_SPLIT_CANDIDATES ? obstacles.size() : MAX_SPLIT_CANDIDATES);
+
+			for (size_t candidateNo = 0; candidateNo < numCandidates; ++candidateNo) {
+				const size_t i = getSplitCandidate(candidateNo, numCandidates, obstacles.size());
+
 				size_t leftSize = 0;
 				size_t rightSize = 0;
 
@@ -237,132 +448,350 @@ namespace RVO {
 				}
 			}
 
-			node->obstacle = obstacleI1;
-			node->left = buildObstacleTreeRecursive(leftObstacles);
-			node->right = buildObstacleTreeRecursive(rightObstacles);
+			obstacleTree_[node].obstacle = obstacleI1;
+			obstacleTree_[node].point1 = obstacleI1->point_;
+			obstacleTree_[node].point2 = obstacleI2->point_;
+			obstacleTree_[node].direction = obstacleI2->point_ - obstacleI1->point_;
+			obstacleTree_[node].invLengthSq = 1.0f / absSq(obstacleTree_[node].direction);
+
+			const size_t left = buildObstacleTreeRecursive(leftObstacles);
+			const size_t right = buildObstacleTreeRecursive(rightObstacles);
+
+			obstacleTree_[node].left = left;
+			obstacleTree_[node].right = right;
+
 			return node;
 		}
 	}
 
 	void KdTree::computeAgentNeighbors(Agent *agent, float &rangeSq) const
 	{
-		queryAgentTreeRecursive(agent, rangeSq, 0);
+		if (!agents_.empty()) {
+			queryAgentTreeRecursive(agent, *agent, rangeSq, 0);
+		}
 	}
 
-	void KdTree::computeObstacleNeighbors(Agent *agent, float rangeSq) const
+	void KdTree::computeApproachingAgents(Agent *agent, ApproachingAgents &agents, float rangeSq) const
 	{
-		queryObstacleTreeRecursive(agent, rangeSq, obstacleTree_);
+		if (!agents_.empty()) {
+			queryAgentTreeRecursive(agent, agents, rangeSq, 0);
+		}
 	}
 
-	void KdTree::deleteObstacleTree(ObstacleTreeNode *node)
+#if RVO_FIXED_MAX_NEIGHBORS
+	void KdTree::computeFixedAgentNeighbors(Agent *agent, FixedAgentNeighbors<RVO_FIXED_MAX_NEIGHBORS> &neighbors, float &rangeSq) const
 	{
-		if (node != NULL) {
-			deleteObstacleTree(node->left);
-			deleteObstacleTree(node->right);
-			delete node;
+		if (!agents_.empty()) {
+			queryAgentTreeRecursive(agent, neighbors, rangeSq, 0);
 		}
 	}
+#endif
 
-	void KdTree::queryAgentTreeRecursive(Agent *agent, float &rangeSq, size_t node) const
+	void KdTree::computeObstacleNeighbors(Agent *agent, float rangeSq) const
 	{
+		if (!obstacleTree_.empty()) {
+			queryObstacleTree(agent, rangeSq);
+		}
+	}
+
+	bool KdTree::isInAgentRange(float distSq, float rangeSq) const
+	{
+		/*
+		 * In deterministic mode, agents at exactly the range may still be
+		 * neighbors, see Agent::insertAgentNeighbor.
+		 */
+		return distSq < rangeSq || (sim_->deterministic_ && distSq == rangeSq);
+	}
+
+	template <class AgentNeighbors>
+	void KdTree::queryAgentTreeRecursive(Agent *agent, AgentNeighbors &neighbors, float &rangeSq, size_t node) const
+	{
+		const Vector2 &position = sim_->agentPositions_[agent->id_];
+
+#if RVO_INSTRUMENTATION
+		++agent->statistics_->numAgentIndexNodeVisits;
+#endif
+
 		if (agentTree_[node].end - agentTree_[node].begin <= MAX_LEAF_SIZE) {
 			for (size_t i = agentTree_[node].begin; i < agentTree_[node].end; ++i) {
-				agent->insertAgentNeighbor(agents_[i], rangeSq);
+				neighbors.insertAgentNeighbor(agents_[i], rangeSq);
 			}
 		}
 		else {
-			const float distSqLeft = sqr(std::max(0.0f, agentTree_[agentTree_[node].left].minX - agent->position_.x())) + sqr(std::max(0.0f, agent->position_.x() - agentTree_[agentTree_[node].left].maxX)) + sqr(std::max(0.0f, agentTree_[agentTree_[node].left].minY - agent->position_.y())) + sqr(std::max(0.0f, agent->position_.y() - agentTree_[agentTree_[node].left].maxY));
+			const float distSqLeft = sqr(std::max(0.0f, agentTree_[agentTree_[node].left].minX - position.x())) + sqr(std::max(0.0f, position.x() - agentTree_[agentTree_[node].left].maxX)) + sqr(std::max(0.0f, agentTree_[agentTree_[node].left].minY - position.y())) + sqr(std::max(0.0f, position.y() - agentTree_[agentTree_[node].left].maxY));
 
-			const float distSqRight = sqr(std::max(0.0f, agentTree_[agentTree_[node].right].minX - agent->position_.x())) + sqr(std::max(0.0f, agent->position_.x() - agentTree_[agentTree_[node].right].maxX)) + sqr(std::max(0.0f, agentTree_[agentTree_[node].right].minY - agent->position_.y())) + sqr(std::max(0.0f, agent->position_.y() - agentTree_[agentTree_[node].right].maxY));
+			const float distSqRight = sqr(std::max(0.0f, agentTree_[agentTree_[node].right].minX - position.x())) + sqr(std::max(0.0f, position.x() - agentTree_[agentTree_[node].right].maxX)) + sqr(std::max(0.0f, agentTree_[agentTree_[node].right].minY - position.y())) + sqr(std::max(0.0f, position.y() - agentTree_[agentTree_[node].right].maxY));
 
 			if (distSqLeft < distSqRight) {
-				if (distSqLeft < rangeSq) {
-					queryAgentTreeRecursive(agent, rangeSq, agentTree_[node].left);
+				if (isInAgentRange(distSqLeft, rangeSq)) {
+					queryAgentTreeRecursive(agent, neighbors, rangeSq, agentTree_[node].left);
 
-					if (distSqRight < rangeSq) {
-						queryAgentTreeRecursive(agent, rangeSq, agentTree_[node].right);
+					if (isInAgentRange(distSqRight, rangeSq)) {
+						queryAgentTreeRecursive(agent, neighbors, rangeSq, agentTree_[node].right);
 					}
 				}
 			}
 			else {
-				if (distSqRight < rangeSq) {
-					queryAgentTreeRecursive(agent, rangeSq, agentTree_[node].right);
+				if (isInAgentRange(distSqRight, rangeSq)) {
+					queryAgentTreeRecursive(agent, neighbors, rangeSq, agentTree_[node].right);
 
-					if (distSqLeft < rangeSq) {
-						queryAgentTreeRecursive(agent, rangeSq, agentTree_[node].left);
+					if (isInAgentRange(distSqLeft, rangeSq)) {
+						queryAgentTreeRecursive(agent, neighbors, rangeSq, agentTree_[node].left);
 					}
 				}
 			}
-
 		}
 	}
 
-	void KdTree::queryObstacleTreeRecursive(Agent *agent, float rangeSq, const ObstacleTreeNode *node) const
+	void KdTree::queryObstacleTree(Agent *agent, float rangeSq) const
 	{
-		if (node == NULL) {
-			return;
-		}
-		else {
-			const Obstacle *const obstacle1 = node->obstacle;
-			const Obstacle *const obstacle2 = obstacle1->nextObstacle_;
+		const Vector2 &position = sim_->agentPositions_[agent->id_];
+
+		std::vector<ObstacleTreeStackEntry> &stack = obstacleTreeStack;
+		stack.clear();
 
-			const float agentLeftOfLine = leftOf(obstacle1->point_, obstacle2->point_, agent->position_);
+		size_t node = 0;
 
-			queryObstacleTreeRecursive(agent, rangeSq, (agentLeftOfLine >= 0.0f ? node->left : node->right));
+		while (true) {
+			/* Descend to the side of the agent, as far as possible. */
+			while (node != RVO_ERROR) {
+				const ObstacleTreeNode &treeNode = obstacleTree_[node];
 
-			const float distSqLine = sqr(agentLeftOfLine) / absSq(obstacle2->point_ - obstacle1->point_);
+#if RVO_INSTRUMENTATION
+				++agent->statistics_->numObstacleTreeNodeVisits;
+#endif
+
+				ObstacleTreeStackEntry entry;
+				entry.node = node;
+				entry.agentLeftOfLine = det(treeNode.point1 - position, treeNode.direction);
+				stack.push_back(entry);
+
+				node = (entry.agentLeftOfLine >= 0.0f ? treeNode.left : treeNode.right);
+			}
+
+			if (stack.empty()) {
+				break;
+			}
+
+			const ObstacleTreeStackEntry entry = stack.back();
+			stack.pop_back();
+
+			const ObstacleTreeNode &treeNode = obstacleTree_[entry.node];
+			const float distSqLine = sqr(entry.agentLeftOfLine) * treeNode.invLengthSq;
 
 			if (distSqLine < rangeSq) {
-				if (agentLeftOfLine < 0.0f) {
+				if (entry.agentLeftOfLine < 0.0f) {
 					/*
 					 * Try obstacle at this node only if agent is on right side of
 					 * obstacle (and can see obstacle).
 					 */
-					agent->insertObstacleNeighbor(node->obstacle, rangeSq);
+					agent->insertObstacleNeighbor(treeNode.obstacle, rangeSq);
 				}
 
 				/* Try other side of line. */
-				queryObstacleTreeRecursive(agent, rangeSq, (agentLeftOfLine >= 0.0f ? node->right : node->left));
-
+				node = (entry.agentLeftOfLine >= 0.0f ? treeNode.right : treeNode.left);
 			}
 		}
 	}
 
-	bool KdTree::queryVisibility(const Vector2 &q1, const Vector2 &q2, float radius) const
+	void KdTree::refitAgentTreeRecursive(size_t node)
 	{
-		return queryVisibilityRecursive(q1, q2, radius, obstacleTree_);
+		AgentTreeNode &treeNode = agentTree_[node];
+
+		if (treeNode.end - treeNode.begin <= MAX_LEAF_SIZE) {
+			const std::vector<Vector2> &positions = sim_->agentPositions_;
+
+			treeNode.minX = treeNode.maxX = positions[agents_[treeNode.begin]].x();
+			treeNode.minY = treeNode.maxY = positions[agents_[treeNode.begin]].y();
+
+			for (size_t i = treeNode.begin + 1; i < treeNode.end; ++i) {
+				treeNode.maxX = std::max(treeNode.maxX, positions[agents_[i]].x());
+				treeNode.minX = std::min(treeNode.minX, positions[agents_[i]].x());
+				treeNode.maxY = std::max(treeNode.maxY, positions[agents_[i]].y());
+				treeNode.minY = std::min(treeNode.minY, positions[agents_[i]].y());
+			}
+		}
+		else {
+			refitAgentTreeRecursive(treeNode.left);
+			refitAgentTreeRecursive(treeNode.right);
+
+			const AgentTreeNode &left = agentTree_[treeNode.left];
+			const AgentTreeNode &right = agentTree_[treeNode.right];
+
+			treeNode.maxX = std::max(left.maxX, right.maxX);
+			treeNode.minX = std::min(left.minX, right.minX);
+			treeNode.maxY = std::max(left.maxY, right.maxY);
+			treeNode.minY = std::min(left.minY, right.minY);
+		}
 	}
 
-	bool KdTree::queryVisibilityRecursive(const Vector2 &q1, const Vector2 &q2, float radius, const ObstacleTreeNode *node) const
+	bool KdTree::queryVisibility(const Vector2 &q1, const Vector2 &q2, float radius) const
 	{
-		if (node == NULL) {
+		if (obstacleTree_.empty()) {
 			return true;
 		}
-		else {
-			const Obstacle *const obstacle1 = node->obstacle;
-			const Obstacle *const obstacle2 = obstacle1->nextObstacle_;
 
-			const float q1LeftOfI = leftOf(obstacle1->point_, obstacle2->point_, q1);
-			const float q2LeftOfI = leftOf(obstacle1->point_, obstacle2->point_, q2);
-			const float invLengthI = 1.0f / absSq(obstacle2->point_ - obstacle1->point_);
+		/*
+		 * The line of sight is visible if it is visible in every subtree that
+		 * it reaches, so the subtrees can be tested in any order.
+		 */
+		std::vector<size_t> &stack = visibilityStack;
+		stack.clear();
+		stack.push_back(0);
+
+		const float radiusSq = sqr(radius);
+
+		while (!stack.empty()) {
+			const ObstacleTreeNode &treeNode = obstacleTree_[stack.back()];
+			stack.pop_back();
+
+			const float q1LeftOfI = det(treeNode.point1 - q1, treeNode.direction);
+			const float q2LeftOfI = det(treeNode.point1 - q2, treeNode.direction);
+
+			size_t near = RVO_ERROR;
+			size_t far = RVO_ERROR;
 
 			if (q1LeftOfI >= 0.0f && q2LeftOfI >= 0.0f) {
-				return queryVisibilityRecursive(q1, q2, radius, node->left) && ((sqr(q1LeftOfI) * invLengthI >= sqr(radius) && sqr(q2LeftOfI) * invLengthI >= sqr(radius)) || queryVisibilityRecursive(q1, q2, radius, node->right));
+				near = treeNode.left;
+
+				if (sqr(q1LeftOfI) * treeNode.invLengthSq < radiusSq || sqr(q2LeftOfI) * treeNode.invLengthSq < radiusSq) {
+					far = treeNode.right;
+				}
 			}
 			else if (q1LeftOfI <= 0.0f && q2LeftOfI <= 0.0f) {
-				return queryVisibilityRecursive(q1, q2, radius, node->right) && ((sqr(q1LeftOfI) * invLengthI >= sqr(radius) && sqr(q2LeftOfI) * invLengthI >= sqr(radius)) || queryVisibilityRecursive(q1, q2, radius, node->left));
+				near = treeNode.right;
+
+				if (sqr(q1LeftOfI) * treeNode.invLengthSq < radiusSq || sqr(q2LeftOfI) * treeNode.invLengthSq < radiusSq) {
+					far = treeNode.left;
+				}
 			}
 			else if (q1LeftOfI >= 0.0f && q2LeftOfI <= 0.0f) {
 				/* One can see through obstacle from left to right. */
-				return queryVisibilityRecursive(q1, q2, radius, node->left) && queryVisibilityRecursive(q1, q2, radius, node->right);
+				near = treeNode.left;
+				far = treeNode.right;
 			}
 			else {
-				const float point1LeftOfQ = leftOf(q1, q2, obstacle1->point_);
-				const float point2LeftOfQ = leftOf(q1, q2, obstacle2->point_);
+				const float point1LeftOfQ = leftOf(q1, q2, treeNode.point1);
+				const float point2LeftOfQ = leftOf(q1, q2, treeNode.point2);
 				const float invLengthQ = 1.0f / absSq(q2 - q1);
 
-				return (point1LeftOfQ * point2LeftOfQ >= 0.0f && sqr(point1LeftOfQ) * invLengthQ > sqr(radius) && sqr(point2LeftOfQ) * invLengthQ > sqr(radius) && queryVisibilityRecursive(q1, q2, radius, node->left) && queryVisibilityRecursive(q1, q2, radius, node->right));
+				if (point1LeftOfQ * point2LeftOfQ < 0.0f || sqr(point1LeftOfQ) * invLengthQ <= radiusSq || sqr(point2LeftOfQ) * invLengthQ <= radiusSq) {
+					return false;
+				}
+
+				near = treeNode.left;
+				far = treeNode.right;
+			}
+
+			if (far != RVO_ERROR) {
+				stack.push_back(far);
+			}
+
+			if (near != RVO_ERROR) {
+				stack.push_back(near);
+			}
+		}
+
+		return true;
+	}
+
+	unsigned int KdTree::queryVisibilityPacket(const Vector2 *q1, const Vector2 *q2, const float *radii, size_t numQueries) const
+	{
+		unsigned int visible = (numQueries == VISIBILITY_PACKET_SIZE ? ~0u : (1u << numQueries) - 1);
+
+		if (obstacleTree_.empty()) {
+			return visible;
+		}
+
+		float radiusSq[VISIBILITY_PACKET_SIZE];
+		float invLengthQ[VISIBILITY_PACKET_SIZE];
+
+		for (size_t i = 0; i < numQueries; ++i) {
+			radiusSq[i] = sqr(radii[i]);
+			invLengthQ[i] = 1.0f / absSq(q2[i] - q1[i]);
+		}
+
+		/*
+		 * The packet descends into a child as soon as one of its queries
+		 * reaches it, carrying the mask of those queries along. Queries that
+		 * are blocked are dropped from all masks, so a subtree that none of the
+		 * remaining queries reaches is skipped.
+		 */
+		std::vector<VisibilityPacketStackEntry> &stack = visibilityPacketStack;
+		stack.clear();
+
+		VisibilityPacketStackEntry root;
+		root.node = 0;
+		root.mask = visible;
+		stack.push_back(root);
+
+		while (!stack.empty()) {
+			const ObstacleTreeNode &treeNode = obstacleTree_[stack.back().node];
+			const unsigned int mask = stack.back().mask & visible;
+			stack.pop_back();
+
+			unsigned int leftMask = 0;
+			unsigned int rightMask = 0;
+
+			for (unsigned int remaining = mask; remaining != 0; remaining &= remaining - 1) {
+				const unsigned int bit = remaining & (0u - remaining);
+				const size_t i = getBitNo(bit);
+
+				const float q1LeftOfI = det(treeNode.point1 - q1[i], treeNode.direction);
+				const float q2LeftOfI = det(treeNode.point1 - q2[i], treeNode.direction);
+
+				if (q1LeftOfI >= 0.0f && q2LeftOfI >= 0.0f) {
+					leftMask |= bit;
+
+					if (sqr(q1LeftOfI) * treeNode.invLengthSq < radiusSq[i] || sqr(q2LeftOfI) * treeNode.invLengthSq < radiusSq[i]) {
+						rightMask |= bit;
+					}
+				}
+				else if (q1LeftOfI <= 0.0f && q2LeftOfI <= 0.0f) {
+					rightMask |= bit;
+
+					if (sqr(q1LeftOfI) * treeNode.invLengthSq < radiusSq[i] || sqr(q2LeftOfI) * treeNode.invLengthSq < radiusSq[i]) {
+						leftMask |= bit;
+					}
+				}
+				else if (q1LeftOfI >= 0.0f && q2LeftOfI <= 0.0f) {
+					/* One can see through obstacle from left to right. */
+					leftMask |= bit;
+					rightMask |= bit;
+				}
+				else {
+					const float point1LeftOfQ = leftOf(q1[i], q2[i], treeNode.point1);
+					const float point2LeftOfQ = leftOf(q1[i], q2[i], treeNode.point2);
+
+					if (point1LeftOfQ * point2LeftOfQ < 0.0f || sqr(point1LeftOfQ) * invLengthQ[i] <= radiusSq[i] || sqr(point2LeftOfQ) * invLengthQ[i] <= radiusSq[i]) {
+						visible &= ~bit;
+					}
+					else {
+						leftMask |= bit;
+						rightMask |= bit;
+					}
+				}
+			}
+
+			if (visible == 0) {
+				break;
+			}
+
+			VisibilityPacketStackEntry entry;
+
+			if (treeNode.right != RVO_ERROR && (rightMask & visible) != 0) {
+				entry.node = treeNode.right;
+				entry.mask = rightMask;
+				stack.push_back(entry);
+			}
+
+			if (treeNode.left != RVO_ERROR && (leftMask & visible) != 0) {
+				entry.node = treeNode.left;
+				entry.mask = leftMask;
+				stack.push_back(entry);
 			}
 		}
+
+		return visible;
 	}
 }
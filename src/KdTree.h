@@ -38,14 +38,14 @@
  * \brief      Contains the KdTree class.
  */
 
-#include "Definitions.h"
+#include "AgentNeighborIndex.h"
 
 namespace RVO {
 	/**
 	 * \brief      Defines <i>k</i>d-trees for agents and static obstacles in the
 	 *             simulation.
 	 */
-	class KdTree {
+	class KdTree : public AgentNeighborIndex {
 	private:
 		/**
 		 * \brief      Defines an agent <i>k</i>d-tree node.
@@ -94,24 +94,49 @@ namespace RVO {
 		};
 
 		/**
-		 * \brief      Defines an obstacle <i>k</i>d-tree node.
+		 * \brief      Defines an obstacle <i>k</i>d-tree node, with the edge of
+		 *             its obstacle inlined so that queries do not follow the
+		 *             obstacle links.
 		 */
 		class ObstacleTreeNode {
 		public:
 			/**
-			 * \brief      The left obstacle tree node.
+			 * \brief      The direction of the edge, from its first to its
+			 *             second endpoint.
 			 */
-			ObstacleTreeNode *left;
+			Vector2 direction;
 
 			/**
-			 * \brief      The obstacle number.
+			 * \brief      The inverse of the squared length of the edge.
+			 */
+			float invLengthSq;
+
+			/**
+			 * \brief      The left node number, or RVO_ERROR when the node has
+			 *             no left child.
+			 */
+			size_t left;
+
+			/**
+			 * \brief      The obstacle at the first endpoint of the edge.
 			 */
 			const Obstacle *obstacle;
 
 			/**
-			 * \brief      The right obstacle tree node.
+			 * \brief      The first endpoint of the edge.
 			 */
-			ObstacleTreeNode *right;
+			Vector2 point1;
+
+			/**
+			 * \brief      The second endpoint of the edge.
+			 */
+			Vector2 point2;
+
+			/**
+			 * \brief      The right node number, or RVO_ERROR when the node has
+			 *             no right child.
+			 */
+			size_t right;
 		};
 
 		/**
@@ -126,19 +151,61 @@ namespace RVO {
 		~KdTree();
 
 		/**
-		 * \brief      Builds an agent <i>k</i>d-tree.
+		 * \brief      Builds the agent <i>k</i>d-tree.
+		 */
+		virtual void buildAgentIndex();
+
+		/**
+		 * \brief      Builds a range of the agent <i>k</i>d-subtrees that are
+		 *             built in parallel.
+		 * \param      begin           The first subtree number.
+		 * \param      end             One past the last subtree number.
+		 */
+		void buildAgentSubtrees(size_t begin, size_t end);
+
+		/**
+		 * \brief      Builds an agent <i>k</i>d-tree, or refits the current one
+		 *             when refitting is enabled and the quality of the refitted
+		 *             tree is within the threshold.
 		 */
 		void buildAgentTree();
 
+		/**
+		 * \brief      Computes the bounding box of an agent <i>k</i>d-tree node
+		 *             and, unless it is a leaf, partitions its agents and
+		 *             assigns the numbers of its children.
+		 * \param      begin           The first agent of the node.
+		 * \param      end             One past the last agent of the node.
+		 * \param      node            The node number.
+		 */
+		void buildAgentTreeNode(size_t begin, size_t end, size_t node);
+
+		/**
+		 * \brief      Builds an agent <i>k</i>d-tree by splitting its top levels
+		 *             sequentially and building the resulting subtrees in
+		 *             parallel, with the same layout as the sequential build.
+		 */
+		void buildAgentTreeParallel();
+
 		void buildAgentTreeRecursive(size_t begin, size_t end, size_t node);
 
+		/**
+		 * \brief      Computes the cost of the agent <i>k</i>d-tree, the sum of
+		 *             the half-perimeters of the bounding boxes of its nodes
+		 *             relative to the half-perimeter of the root.
+		 * \return     The cost of the agent <i>k</i>d-tree.
+		 */
+		float computeAgentTreeCost() const;
+
+		float computeAgentTreeCostRecursive(size_t node) const;
+
 		/**
 		 * \brief      Builds an obstacle <i>k</i>d-tree.
 		 */
 		void buildObstacleTree();
 
-		ObstacleTreeNode *buildObstacleTreeRecursive(const std::vector<Obstacle *> &
-													 obstacles);
+		size_t buildObstacleTreeRecursive(const std::vector<Obstacle *> &
+										  obstacles);
 
 		/**
 		 * \brief      Computes the agent neighbors of the specified agent.
@@ -146,8 +213,34 @@ namespace RVO {
 		 *                             neighbors are to be computed.
 		 * \param      rangeSq         The squared range around the agent.
 		 */
-		void computeAgentNeighbors(Agent *agent, float &rangeSq) const;
+		virtual void computeAgentNeighbors(Agent *agent, float &rangeSq) const;
+
+		/**
+		 * \brief      Tests whether an awake agent moving faster than the sleep
+		 *             speed approaches the specified sleeping agent.
+		 * \param      agent           A pointer to the sleeping agent.
+		 * \param      agents          The test of the approaching agents.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		virtual void computeApproachingAgents(Agent *agent,
+											  ApproachingAgents &agents,
+											  float rangeSq) const;
+
+#if RVO_FIXED_MAX_NEIGHBORS
+		/**
+		 * \brief      Computes the agent neighbors of the specified agent into
+		 *             a set with a maximum number of agent neighbors fixed at
+		 *             compile time.
+		 * \param      agent           A pointer to the agent for which agent
+		 *                             neighbors are to be computed.
+		 * \param      neighbors       The set of agent neighbors.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		virtual void computeFixedAgentNeighbors(Agent *agent,
+												FixedAgentNeighbors<RVO_FIXED_MAX_NEIGHBORS> &neighbors,
+												float &rangeSq) const;
 
+#endif
 		/**
 		 * \brief      Computes the obstacle neighbors of the specified agent.
 		 * \param      agent           A pointer to the agent for which obstacle
@@ -157,17 +250,48 @@ namespace RVO {
 		void computeObstacleNeighbors(Agent *agent, float rangeSq) const;
 
 		/**
-		 * \brief      Deletes the specified obstacle tree node.
-		 * \param      node            A pointer to the obstacle tree node to be
-		 *                             deleted.
+		 * \brief      Returns whether a node of the agent <i>k</i>d-tree is to be
+		 *             visited by an agent neighbor query.
+		 * \param      distSq          The squared distance from the query point
+		 *                             to the bounding box of the node.
+		 * \param      rangeSq         The squared range of the query.
+		 * \return     True if the node may contain agent neighbors.
 		 */
-		void deleteObstacleTree(ObstacleTreeNode *node);
+		bool isInAgentRange(float distSq, float rangeSq) const;
 
-		void queryAgentTreeRecursive(Agent *agent, float &rangeSq,
-									 size_t node) const;
+		/**
+		 * \brief      Queries a subtree of the agent <i>k</i>d-tree for the
+		 *             agent neighbors of the specified agent.
+		 * \param      agent           A pointer to the agent for which agent
+		 *                             neighbors are to be computed.
+		 * \param      neighbors       The set into which the agent neighbors
+		 *                             are inserted, the agent itself, a set
+		 *                             with a fixed maximum number of agent
+		 *                             neighbors, or a test of approaching
+		 *                             agents.
+		 * \param      rangeSq         The squared range around the agent.
+		 * \param      node            The root node of the subtree.
+		 */
+		template <class AgentNeighbors>
+		void queryAgentTreeRecursive(Agent *agent, AgentNeighbors &neighbors,
+									 float &rangeSq, size_t node) const;
 
-		void queryObstacleTreeRecursive(Agent *agent, float rangeSq,
-										const ObstacleTreeNode *node) const;
+		/**
+		 * \brief      Updates the bounding boxes of the agent <i>k</i>d-tree
+		 *             bottom-up for the current agent positions, keeping the
+		 *             partition of the agents.
+		 */
+		void refitAgentTreeRecursive(size_t node);
+
+		/**
+		 * \brief      Queries the obstacle <i>k</i>d-tree for the obstacle
+		 *             neighbors of the specified agent, visiting the nodes in
+		 *             order with an explicit stack.
+		 * \param      agent           A pointer to the agent for which obstacle
+		 *                             neighbors are to be computed.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		void queryObstacleTree(Agent *agent, float rangeSq) const;
 
 		/**
 		 * \brief      Queries the visibility between two points within a
@@ -184,16 +308,37 @@ namespace RVO {
 		bool queryVisibility(const Vector2 &q1, const Vector2 &q2,
 							 float radius) const;
 
-		bool queryVisibilityRecursive(const Vector2 &q1, const Vector2 &q2,
-									  float radius,
-									  const ObstacleTreeNode *node) const;
+		/**
+		 * \brief      Queries the visibility for a packet of line segments that
+		 *             traverse the obstacle <i>k</i>d-tree together, so that the
+		 *             nodes near the root are loaded once per packet rather than
+		 *             once per query.
+		 * \param      q1              The first points of the queries.
+		 * \param      q2              The second points of the queries.
+		 * \param      radii           The radii within which visibility is to
+		 *                             be tested.
+		 * \param      numQueries      The number of queries, at most
+		 *                             VISIBILITY_PACKET_SIZE.
+		 * \return     A mask whose bit i is set if the points of query i are
+		 *             mutually visible within its radius.
+		 */
+		unsigned int queryVisibilityPacket(const Vector2 *q1, const Vector2 *q2,
+										   const float *radii,
+										   size_t numQueries) const;
 
-		std::vector<Agent *> agents_;
+		std::vector<size_t> agents_;
+		bool agentsChanged_;
+		std::vector<size_t> agentSubtrees_;
 		std::vector<AgentTreeNode> agentTree_;
-		ObstacleTreeNode *obstacleTree_;
+		float agentTreeCost_;
+		float agentTreeRefitThreshold_;
+		std::vector<ObstacleTreeNode> obstacleTree_;
 		RVOSimulator *sim_;
 
 		static const size_t MAX_LEAF_SIZE = 10;
+		static const size_t MAX_SPLIT_CANDIDATES = 64;
+		static const size_t MIN_PARALLEL_SUBTREE_SIZE = 1024;
+		static const size_t VISIBILITY_PACKET_SIZE = 32;
 
 		friend class Agent;
 		friend class RVOSimulator;
@@ -0,0 +1,268 @@
+/*
+ * NavigationField.cpp
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#include "NavigationField.h"
+
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include "Agent.h"
+#include "RVOSimulator.h"
+
+namespace RVO {
+	namespace {
+		/*
+		 * The offsets of the eight neighbors of a cell, ordered so that the
+		 * opposite of direction d is direction 7 - d.
+		 */
+		const int neighborOffsetsX[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+		const int neighborOffsetsY[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+		/* Returns whether the bit with the specified number is set. */
+		inline bool isBitSet(const std::vector<std::uint64_t> &bits, size_t bitNo)
+		{
+			return ((bits[bitNo / 64] >> (bitNo % 64)) & 1) != 0;
+		}
+	}
+
+	NavigationField::NavigationField(RVOSimulator *sim, const Vector2 &minCorner, const Vector2 &maxCorner, float cellSize, float radius) : cellSize_(cellSize), invCellSize_(1.0f / cellSize), minCorner_(minCorner), numCellsX_(0), numCellsY_(0), radius_(radius), sim_(sim)
+	{
+		numCellsX_ = std::max(static_cast<size_t>(std::ceil((maxCorner.x() - minCorner.x()) * invCellSize_)), static_cast<size_t>(1));
+		numCellsY_ = std::max(static_cast<size_t>(std::ceil((maxCorner.y() - minCorner.y()) * invCellSize_)), static_cast<size_t>(1));
+	}
+
+	size_t NavigationField::addGoal(const Vector2 &goal)
+	{
+		if (goal.x() < minCorner_.x() || goal.y() < minCorner_.y() || goal.x() > minCorner_.x() + numCellsX_ * cellSize_ || goal.y() > minCorner_.y() + numCellsY_ * cellSize_) {
+			return RVO_ERROR;
+		}
+
+		/*
+		 * The edges between neighboring cells only depend on the obstacles, so
+		 * they are queried in two batches for the first goal and reused.
+		 */
+		if (clearEdges_.empty()) {
+			computeEdges(radius_, clearEdges_);
+			computeEdges(0.0f, openEdges_);
+		}
+
+		const size_t numCells = numCellsX_ * numCellsY_;
+		const size_t goalNo = targets_.size() / numCells;
+		const size_t offset = goalNo * numCells;
+
+		targets_.resize(offset + numCells);
+		targetDistances_.resize(offset + numCells, std::numeric_limits<float>::max());
+
+		std::vector<float> cellDistances(numCells, std::numeric_limits<float>::max());
+		std::vector<char> reached(numCells, 0);
+		std::priority_queue<std::pair<float, size_t>, std::vector<std::pair<float, size_t> >, std::greater<std::pair<float, size_t> > > heap;
+
+		const size_t goalCell = getCell(goal);
+		targets_[offset + goalCell] = goal;
+		targetDistances_[offset + goalCell] = 0.0f;
+		cellDistances[goalCell] = abs(getCellCenter(goalCell) - goal);
+		heap.push(std::make_pair(cellDistances[goalCell], goalCell));
+
+		/*
+		 * Two passes: the first reaches the cells with paths that keep the
+		 * clearance from the obstacles, the second reaches the remaining cells
+		 * along the clearance band with paths that merely do not cross the
+		 * obstacles, so that agents pushed close to an obstacle still find
+		 * their way back.
+		 */
+		for (size_t pass = 0; pass < 2; ++pass) {
+			const std::vector<std::uint64_t> &edges = (pass == 0 ? clearEdges_ : openEdges_);
+			std::vector<char> done(numCells, 0);
+
+			if (pass == 1) {
+				for (size_t cell = 0; cell < numCells; ++cell) {
+					if (reached[cell]) {
+						heap.push(std::make_pair(cellDistances[cell], cell));
+					}
+				}
+			}
+
+			while (!heap.empty()) {
+				const size_t cell = heap.top().second;
+				heap.pop();
+
+				if (done[cell]) {
+					continue;
+				}
+
+				done[cell] = 1;
+
+				if (pass == 0) {
+					reached[cell] = 1;
+				}
+
+				const Vector2 center = getCellCenter(cell);
+				const size_t cellX = cell % numCellsX_;
+				const size_t cellY = cell / numCellsX_;
+
+				for (size_t direction = 0; direction < 8; ++direction) {
+					const int neighborX = static_cast<int>(cellX) + neighborOffsetsX[direction];
+					const int neighborY = static_cast<int>(cellY) + neighborOffsetsY[direction];
+
+					if (neighborX < 0 || neighborY < 0 || neighborX >= static_cast<int>(numCellsX_) || neighborY >= static_cast<int>(numCellsY_)) {
+						continue;
+					}
+
+					const size_t neighbor = neighborY * numCellsX_ + neighborX;
+
+					if (done[neighbor] || (pass == 1 && reached[neighbor]) || !isBitSet(edges, 8 * neighbor + 7 - direction)) {
+						continue;
+					}
+
+					const Vector2 neighborCenter = getCellCenter(neighbor);
+					const Vector2 &target = targets_[offset + cell];
+
+					Vector2 newTarget = center;
+					float newTargetDistance = cellDistances[cell];
+
+					if (pass == 0 && sim_->queryVisibility(neighborCenter, target, radius_)) {
+						newTarget = target;
+						newTargetDistance = targetDistances_[offset + cell];
+					}
+
+					const float distance = abs(newTarget - neighborCenter) + newTargetDistance;
+
+					if (distance < cellDistances[neighbor]) {
+						cellDistances[neighbor] = distance;
+						targets_[offset + neighbor] = newTarget;
+						targetDistances_[offset + neighbor] = newTargetDistance;
+						heap.push(std::make_pair(distance, neighbor));
+					}
+				}
+			}
+		}
+
+		return goalNo;
+	}
+
+	void NavigationField::computeEdges(float radius, std::vector<std::uint64_t> &edges) const
+	{
+		const size_t numCells = numCellsX_ * numCellsY_;
+
+		std::vector<Vector2> points1(8 * numCells);
+		std::vector<Vector2> points2(8 * numCells);
+
+		for (size_t cell = 0; cell < numCells; ++cell) {
+			const Vector2 center = getCellCenter(cell);
+
+			for (size_t direction = 0; direction < 8; ++direction) {
+				points1[8 * cell + direction] = center;
+				points2[8 * cell + direction] = center + cellSize_ * Vector2(static_cast<float>(neighborOffsetsX[direction]), static_cast<float>(neighborOffsetsY[direction]));
+			}
+		}
+
+		sim_->queryVisibility(points1, points2, std::vector<float>(8 * numCells, radius), edges);
+	}
+
+	size_t NavigationField::getCell(const Vector2 &point) const
+	{
+		const float x = (point.x() - minCorner_.x()) * invCellSize_;
+		const float y = (point.y() - minCorner_.y()) * invCellSize_;
+
+		const size_t cellX = (x <= 0.0f ? 0 : std::min(static_cast<size_t>(x), numCellsX_ - 1));
+		const size_t cellY = (y <= 0.0f ? 0 : std::min(static_cast<size_t>(y), numCellsY_ - 1));
+
+		return cellY * numCellsX_ + cellX;
+	}
+
+	Vector2 NavigationField::getCellCenter(size_t cell) const
+	{
+		return minCorner_ + cellSize_ * Vector2(static_cast<float>(cell % numCellsX_) + 0.5f, static_cast<float>(cell / numCellsX_) + 0.5f);
+	}
+
+	Vector2 NavigationField::getDirection(size_t goalNo, const Vector2 &point) const
+	{
+		const size_t i = goalNo * numCellsX_ * numCellsY_ + getCell(point);
+
+		if (targetDistances_[i] == std::numeric_limits<float>::max()) {
+			return Vector2();
+		}
+
+		const Vector2 toTarget = targets_[i] - point;
+		const float distSq = absSq(toTarget);
+
+		return (distSq > 0.0f ? toTarget / std::sqrt(distSq) : Vector2());
+	}
+
+	float NavigationField::getDistance(size_t goalNo, const Vector2 &point) const
+	{
+		const size_t i = goalNo * numCellsX_ * numCellsY_ + getCell(point);
+
+		if (targetDistances_[i] == std::numeric_limits<float>::max()) {
+			return std::numeric_limits<float>::max();
+		}
+
+		return abs(targets_[i] - point) + targetDistances_[i];
+	}
+
+	void NavigationField::setAgentPrefVelocities(const std::vector<size_t> &goalNos) const
+	{
+		const size_t numCells = numCellsX_ * numCellsY_;
+		const float invTimeStep = 1.0f / sim_->timeStep_;
+
+		/*
+		 * One pass over the agent arrays in memory order; each agent costs a
+		 * cell lookup and a square root.
+		 */
+		for (size_t i = 0; i < sim_->agents_.size(); ++i) {
+			if (!sim_->agentActive_[i]) {
+				continue;
+			}
+
+			const size_t goalNo = goalNos[sim_->agentNumbers_[i]];
+
+			if (goalNo == RVO_ERROR) {
+				continue;
+			}
+
+			const Vector2 &position = sim_->agentPositions_[i];
+			const size_t j = goalNo * numCells + getCell(position);
+
+			if (targetDistances_[j] == std::numeric_limits<float>::max()) {
+				sim_->agentPrefVelocities_[i] = Vector2();
+				continue;
+			}
+
+			const Vector2 toTarget = targets_[j] - position;
+			const float dist = abs(toTarget);
+			const float speed = std::min(sim_->agentProfiles_[sim_->agents_[i]->profileNo_].maxSpeed, (dist + targetDistances_[j]) * invTimeStep);
+
+			sim_->agentPrefVelocities_[i] = (dist > 0.0f ? toTarget * (speed / dist) : Vector2());
+		}
+	}
+}
@@ -0,0 +1,153 @@
+/*
+ * NavigationField.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#ifndef RVO_NAVIGATION_FIELD_H_
+#define RVO_NAVIGATION_FIELD_H_
+
+/**
+ * \file       NavigationField.h
+ * \brief      Contains the NavigationField class.
+ */
+
+#include <cstdint>
+
+#include "Definitions.h"
+
+namespace RVO {
+	/**
+	 * \brief      Defines goal distance fields on a uniform grid that guide the
+	 *             agents around the obstacles to their goals.
+	 *
+	 * The field of a goal stores, for every cell, a target point that is
+	 * visible from the center of the cell and the distance from the target
+	 * point to the goal. The target points are found by a Dijkstra search
+	 * from the goal over the cells with a binary heap, which takes a shortcut
+	 * to the target point of a cell whenever it is visible, so that the paths
+	 * are not restricted to the eight grid directions. The direction to the
+	 * goal at a point is the direction to the target point of its cell.
+	 */
+	class NavigationField {
+	private:
+		/**
+		 * \brief      Constructs a navigation field instance.
+		 * \param      sim             The simulator instance.
+		 * \param      minCorner       The minimum corner of the grid.
+		 * \param      maxCorner       The maximum corner of the grid.
+		 * \param      cellSize        The cell size of the grid.
+		 * \param      radius          The clearance of the paths from the
+		 *                             obstacles.
+		 */
+		NavigationField(RVOSimulator *sim, const Vector2 &minCorner,
+						const Vector2 &maxCorner, float cellSize, float radius);
+
+		/**
+		 * \brief      Builds the field of a new goal.
+		 * \param      goal            The two-dimensional position of the
+		 *                             goal.
+		 * \return     The number of the goal, or RVO_ERROR when the goal is
+		 *             outside of the grid.
+		 */
+		size_t addGoal(const Vector2 &goal);
+
+		/**
+		 * \brief      Queries the visibility between the center of every cell
+		 *             and the centers of its eight neighbors.
+		 * \param      radius          The radius within which visibility is to
+		 *                             be tested.
+		 * \param      edges           A reference to the bitmask of the
+		 *                             results, with bit 8 * cell + direction
+		 *                             set if the neighbor in the direction is
+		 *                             visible from the cell.
+		 */
+		void computeEdges(float radius, std::vector<std::uint64_t> &edges) const;
+
+		/**
+		 * \brief      Returns the cell that contains the specified point, or
+		 *             the nearest cell when the point is outside of the grid.
+		 * \param      point           The two-dimensional point.
+		 * \return     The number of the cell.
+		 */
+		size_t getCell(const Vector2 &point) const;
+
+		/**
+		 * \brief      Returns the center of the specified cell.
+		 * \param      cell            The number of the cell.
+		 * \return     The two-dimensional center of the cell.
+		 */
+		Vector2 getCellCenter(size_t cell) const;
+
+		/**
+		 * \brief      Returns the direction to a goal at the specified point.
+		 * \param      goalNo          The number of the goal.
+		 * \param      point           The two-dimensional point.
+		 * \return     The unit direction to the goal, or the zero vector when
+		 *             the goal is not reachable or the point is at the goal.
+		 */
+		Vector2 getDirection(size_t goalNo, const Vector2 &point) const;
+
+		/**
+		 * \brief      Returns the distance to a goal from the specified point.
+		 * \param      goalNo          The number of the goal.
+		 * \param      point           The two-dimensional point.
+		 * \return     The length of the path to the goal, or the maximum float
+		 *             value when the goal is not reachable.
+		 */
+		float getDistance(size_t goalNo, const Vector2 &point) const;
+
+		/**
+		 * \brief      Sets the preferred velocities of the agents towards their
+		 *             goals, at their maximum speeds but without overshooting
+		 *             the goals within a time step.
+		 * \param      goalNos         The numbers of the goals of the agents,
+		 *                             by agent number. Agents with goal
+		 *                             RVO_ERROR keep their preferred
+		 *                             velocities.
+		 */
+		void setAgentPrefVelocities(const std::vector<size_t> &goalNos) const;
+
+		float cellSize_;
+		std::vector<std::uint64_t> clearEdges_;
+		float invCellSize_;
+		Vector2 minCorner_;
+		size_t numCellsX_;
+		size_t numCellsY_;
+		std::vector<std::uint64_t> openEdges_;
+		float radius_;
+		RVOSimulator *sim_;
+		std::vector<float> targetDistances_;
+		std::vector<Vector2> targets_;
+
+		friend class RVOSimulator;
+	};
+}
+
+#endif /* RVO_NAVIGATION_FIELD_H_ */
@@ -35,4 +35,23 @@
 
 namespace RVO {
 	Obstacle::Obstacle() : isConvex_(false), nextObstacle_(NULL), prevObstacle_(NULL), id_(0) { }
+
+	void Obstacle::linkVertices(Obstacle *const *vertices, size_t numVertices)
+	{
+		for (size_t i = 0; i < numVertices; ++i) {
+			Obstacle *const prev = vertices[(i == 0 ? numVertices - 1 : i - 1)];
+			Obstacle *const next = vertices[(i == numVertices - 1 ? 0 : i + 1)];
+
+			vertices[i]->prevObstacle_ = prev;
+			vertices[i]->nextObstacle_ = next;
+			vertices[i]->unitDir_ = normalize(next->point_ - vertices[i]->point_);
+
+			if (numVertices == 2) {
+				vertices[i]->isConvex_ = true;
+			}
+			else {
+				vertices[i]->isConvex_ = (leftOf(prev->point_, vertices[i]->point_, next->point_) >= 0.0f);
+			}
+		}
+	}
 }
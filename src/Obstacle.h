@@ -42,7 +42,7 @@
 
 namespace RVO {
 	/**
-	 * \brief      Defines static obstacles in the simulation.
+	 * \brief      Defines static and dynamic obstacles in the simulation.
 	 */
 	class Obstacle {
 	private:
@@ -51,6 +51,16 @@ namespace RVO {
 		 */
 		Obstacle();
 
+		/**
+		 * \brief      Links the vertices of a polygonal obstacle into a cycle
+		 *             and computes their directions and convexity.
+		 * \param      vertices        The vertices of the polygonal obstacle in
+		 *                             counterclockwise order, with their points
+		 *                             set.
+		 * \param      numVertices     The number of vertices, at least two.
+		 */
+		static void linkVertices(Obstacle *const *vertices, size_t numVertices);
+
 		bool isConvex_;
 		Obstacle *nextObstacle_;
 		Vector2 point_;
@@ -61,6 +71,7 @@ namespace RVO {
 
 		friend class Agent;
 		friend class KdTree;
+		friend class ObstacleGrid;
 		friend class RVOSimulator;
 	};
 }
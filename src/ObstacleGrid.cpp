@@ -0,0 +1,311 @@
+/*
+ * ObstacleGrid.cpp
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#include "ObstacleGrid.h"
+
+#include "Agent.h"
+#include "Obstacle.h"
+#include "RVOSimulator.h"
+
+namespace RVO {
+	ObstacleGrid::ObstacleGrid(RVOSimulator *sim) : cellSize_(10.0f), invCellSize_(0.1f), numEntries_(0), sim_(sim) { }
+
+	ObstacleGrid::~ObstacleGrid()
+	{
+		for (size_t i = 0; i < obstacles_.size(); ++i) {
+			for (size_t j = 0; j < obstacles_[i].size(); ++j) {
+				delete obstacles_[i][j];
+			}
+		}
+	}
+
+	size_t ObstacleGrid::addObstacle(const std::vector<Vector2> &vertices)
+	{
+		size_t obstacleNo;
+
+		if (!freeObstacles_.empty()) {
+			obstacleNo = freeObstacles_.back();
+			freeObstacles_.pop_back();
+		}
+		else {
+			obstacleNo = obstacles_.size();
+			obstacles_.push_back(std::vector<Obstacle *>());
+			numObstacleVertices_.push_back(0);
+		}
+
+		std::vector<Obstacle *> &obstacle = obstacles_[obstacleNo];
+
+		while (obstacle.size() < vertices.size()) {
+			obstacle.push_back(new Obstacle());
+		}
+
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			obstacle[i]->point_ = vertices[i];
+			obstacle[i]->id_ = RVO_ERROR;
+		}
+
+		Obstacle::linkVertices(&obstacle[0], vertices.size());
+		numObstacleVertices_[obstacleNo] = vertices.size();
+
+		for (size_t i = 0; i < vertices.size(); ++i) {
+			insertEdge(obstacle[i]);
+		}
+
+		if (numEntries_ > 2 * buckets_.size()) {
+			rehash();
+		}
+
+		return obstacleNo;
+	}
+
+	void ObstacleGrid::computeObstacleNeighbors(Agent *agent, float rangeSq) const
+	{
+		if (numEntries_ == 0) {
+			return;
+		}
+
+		const Vector2 &position = sim_->agentPositions_[agent->id_];
+		const float range = std::sqrt(rangeSq);
+		const int minCellX = getCell(position.x() - range);
+		const int maxCellX = getCell(position.x() + range);
+		const int minCellY = getCell(position.y() - range);
+		const int maxCellY = getCell(position.y() + range);
+
+		for (int y = minCellY; y <= maxCellY; ++y) {
+			for (int x = minCellX; x <= maxCellX; ++x) {
+				const std::vector<const Obstacle *> &bucket = buckets_[getBucket(x, y)];
+
+				for (size_t i = 0; i < bucket.size(); ++i) {
+					int edgeMinCellX, edgeMinCellY, edgeMaxCellX, edgeMaxCellY;
+					getEdgeCells(bucket[i], edgeMinCellX, edgeMinCellY, edgeMaxCellX, edgeMaxCellY);
+
+					/*
+					 * Skip edges of other cells that share the bucket, and edges
+					 * that were already considered in a previous cell.
+					 */
+					if (x != std::max(edgeMinCellX, minCellX) || y != std::max(edgeMinCellY, minCellY) || x > edgeMaxCellX || y > edgeMaxCellY) {
+						continue;
+					}
+
+					const Obstacle *const obstacle1 = bucket[i];
+					const Obstacle *const obstacle2 = obstacle1->nextObstacle_;
+
+					/*
+					 * Try the edge only if the agent is on its right side (and
+					 * can see the obstacle).
+					 */
+					if (leftOf(obstacle1->point_, obstacle2->point_, position) < 0.0f) {
+						agent->insertObstacleNeighbor(obstacle1, rangeSq);
+					}
+				}
+			}
+		}
+	}
+
+	size_t ObstacleGrid::getBucket(int cellX, int cellY) const
+	{
+		/* The number of buckets is a power of two; mask with one less. */
+		return static_cast<size_t>((static_cast<unsigned int>(cellX) * 73856093u) ^ (static_cast<unsigned int>(cellY) * 19349663u)) & (buckets_.size() - 1);
+	}
+
+	int ObstacleGrid::getCell(float coordinate) const
+	{
+		return static_cast<int>(std::floor(coordinate * invCellSize_));
+	}
+
+	void ObstacleGrid::getEdgeCells(const Obstacle *obstacle, int &minCellX, int &minCellY, int &maxCellX, int &maxCellY) const
+	{
+		const Vector2 &point1 = obstacle->point_;
+		const Vector2 &point2 = obstacle->nextObstacle_->point_;
+
+		minCellX = getCell(std::min(point1.x(), point2.x()));
+		minCellY = getCell(std::min(point1.y(), point2.y()));
+		maxCellX = getCell(std::max(point1.x(), point2.x()));
+		maxCellY = getCell(std::max(point1.y(), point2.y()));
+	}
+
+	void ObstacleGrid::insertEdge(const Obstacle *obstacle)
+	{
+		if (buckets_.empty()) {
+			buckets_.resize(MIN_NUM_BUCKETS);
+		}
+
+		int minCellX, minCellY, maxCellX, maxCellY;
+		getEdgeCells(obstacle, minCellX, minCellY, maxCellX, maxCellY);
+
+		for (int y = minCellY; y <= maxCellY; ++y) {
+			for (int x = minCellX; x <= maxCellX; ++x) {
+				std::vector<const Obstacle *> &bucket = buckets_[getBucket(x, y)];
+
+				/*
+				 * An edge is stored once per bucket even when several of its
+				 * cells share the bucket; its cells are inserted consecutively.
+				 */
+				if (bucket.empty() || bucket.back() != obstacle) {
+					bucket.push_back(obstacle);
+					++numEntries_;
+				}
+			}
+		}
+	}
+
+	void ObstacleGrid::moveObstacle(size_t obstacleNo, const Vector2 &displacement)
+	{
+		const std::vector<Obstacle *> &obstacle = obstacles_[obstacleNo];
+		const size_t numVertices = numObstacleVertices_[obstacleNo];
+
+		for (size_t i = 0; i < numVertices; ++i) {
+			removeEdge(obstacle[i]);
+		}
+
+		/* A translation keeps the directions and convexity of the vertices. */
+		for (size_t i = 0; i < numVertices; ++i) {
+			obstacle[i]->point_ += displacement;
+		}
+
+		for (size_t i = 0; i < numVertices; ++i) {
+			insertEdge(obstacle[i]);
+		}
+
+		if (numEntries_ > 2 * buckets_.size()) {
+			rehash();
+		}
+	}
+
+	bool ObstacleGrid::queryVisibility(const Vector2 &q1, const Vector2 &q2, float radius) const
+	{
+		if (numEntries_ == 0) {
+			return true;
+		}
+
+		const int minCellX = getCell(std::min(q1.x(), q2.x()) - radius);
+		const int maxCellX = getCell(std::max(q1.x(), q2.x()) + radius);
+		const int minCellY = getCell(std::min(q1.y(), q2.y()) - radius);
+		const int maxCellY = getCell(std::max(q1.y(), q2.y()) + radius);
+
+		const float invLengthQ = 1.0f / absSq(q2 - q1);
+
+		for (int y = minCellY; y <= maxCellY; ++y) {
+			for (int x = minCellX; x <= maxCellX; ++x) {
+				const std::vector<const Obstacle *> &bucket = buckets_[getBucket(x, y)];
+
+				for (size_t i = 0; i < bucket.size(); ++i) {
+					int edgeMinCellX, edgeMinCellY, edgeMaxCellX, edgeMaxCellY;
+					getEdgeCells(bucket[i], edgeMinCellX, edgeMinCellY, edgeMaxCellX, edgeMaxCellY);
+
+					if (x != std::max(edgeMinCellX, minCellX) || y != std::max(edgeMinCellY, minCellY) || x > edgeMaxCellX || y > edgeMaxCellY) {
+						continue;
+					}
+
+					const Vector2 &point1 = bucket[i]->point_;
+					const Vector2 &point2 = bucket[i]->nextObstacle_->point_;
+
+					/*
+					 * As for static obstacles, the line of sight is blocked by an
+					 * edge that it enters from the right side, unless both
+					 * endpoints of the edge are on the same side of the line of
+					 * sight, at least the radius away.
+					 */
+					if (leftOf(point1, point2, q1) < 0.0f && leftOf(point1, point2, q2) > 0.0f) {
+						const float point1LeftOfQ = leftOf(q1, q2, point1);
+						const float point2LeftOfQ = leftOf(q1, q2, point2);
+
+						if (point1LeftOfQ * point2LeftOfQ < 0.0f || sqr(point1LeftOfQ) * invLengthQ <= sqr(radius) || sqr(point2LeftOfQ) * invLengthQ <= sqr(radius)) {
+							return false;
+						}
+					}
+				}
+			}
+		}
+
+		return true;
+	}
+
+	void ObstacleGrid::rehash()
+	{
+		size_t numBuckets = MIN_NUM_BUCKETS;
+
+		while (numBuckets < numEntries_) {
+			numBuckets *= 2;
+		}
+
+		buckets_.assign(numBuckets, std::vector<const Obstacle *>());
+		numEntries_ = 0;
+
+		for (size_t i = 0; i < obstacles_.size(); ++i) {
+			for (size_t j = 0; j < numObstacleVertices_[i]; ++j) {
+				insertEdge(obstacles_[i][j]);
+			}
+		}
+	}
+
+	void ObstacleGrid::removeEdge(const Obstacle *obstacle)
+	{
+		int minCellX, minCellY, maxCellX, maxCellY;
+		getEdgeCells(obstacle, minCellX, minCellY, maxCellX, maxCellY);
+
+		for (int y = minCellY; y <= maxCellY; ++y) {
+			for (int x = minCellX; x <= maxCellX; ++x) {
+				std::vector<const Obstacle *> &bucket = buckets_[getBucket(x, y)];
+
+				for (size_t i = 0; i < bucket.size(); ++i) {
+					if (bucket[i] == obstacle) {
+						bucket[i] = bucket.back();
+						bucket.pop_back();
+						--numEntries_;
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	void ObstacleGrid::removeObstacle(size_t obstacleNo)
+	{
+		for (size_t i = 0; i < numObstacleVertices_[obstacleNo]; ++i) {
+			removeEdge(obstacles_[obstacleNo][i]);
+		}
+
+		numObstacleVertices_[obstacleNo] = 0;
+		freeObstacles_.push_back(obstacleNo);
+	}
+
+	void ObstacleGrid::setCellSize(float cellSize)
+	{
+		cellSize_ = cellSize;
+		invCellSize_ = 1.0f / cellSize;
+
+		if (!buckets_.empty()) {
+			rehash();
+		}
+	}
+}
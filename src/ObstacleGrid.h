@@ -0,0 +1,185 @@
+/*
+ * ObstacleGrid.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#ifndef RVO_OBSTACLE_GRID_H_
+#define RVO_OBSTACLE_GRID_H_
+
+/**
+ * \file       ObstacleGrid.h
+ * \brief      Contains the ObstacleGrid class.
+ */
+
+#include "Definitions.h"
+
+namespace RVO {
+	/**
+	 * \brief      Defines a uniform-grid spatial hash of the edges of the
+	 *             dynamic obstacles in the simulation.
+	 *
+	 * Each edge is stored in the buckets of the grid cells that its bounding
+	 * box overlaps, so adding, moving or removing an obstacle only updates the
+	 * buckets of its own edges. A query visits the cells that its range
+	 * overlaps and considers each edge only in the first of these cells that
+	 * the edge overlaps.
+	 */
+	class ObstacleGrid {
+	private:
+		/**
+		 * \brief      Constructs an obstacle grid instance.
+		 * \param      sim             The simulator instance.
+		 */
+		explicit ObstacleGrid(RVOSimulator *sim);
+
+		/**
+		 * \brief      Destroys this obstacle grid instance and its obstacles.
+		 */
+		~ObstacleGrid();
+
+		/**
+		 * \brief      Adds a new dynamic obstacle.
+		 * \param      vertices        List of the vertices of the polygonal
+		 *                             obstacle in counterclockwise order, at
+		 *                             least two.
+		 * \return     The number of the dynamic obstacle.
+		 */
+		size_t addObstacle(const std::vector<Vector2> &vertices);
+
+		/**
+		 * \brief      Computes the dynamic obstacle neighbors of the specified
+		 *             agent.
+		 * \param      agent           A pointer to the agent for which obstacle
+		 *                             neighbors are to be computed.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		void computeObstacleNeighbors(Agent *agent, float rangeSq) const;
+
+		/**
+		 * \brief      Returns the bucket of the specified grid cell.
+		 * \param      cellX           The x-coordinate of the grid cell.
+		 * \param      cellY           The y-coordinate of the grid cell.
+		 * \return     The number of the bucket of the grid cell.
+		 */
+		size_t getBucket(int cellX, int cellY) const;
+
+		/**
+		 * \brief      Returns the grid cell coordinate of the specified
+		 *             coordinate.
+		 * \param      coordinate      The x- or y-coordinate of a point.
+		 * \return     The corresponding x- or y-coordinate of the grid cell.
+		 */
+		int getCell(float coordinate) const;
+
+		/**
+		 * \brief      Computes the range of grid cells that the bounding box of
+		 *             the edge starting at the specified vertex overlaps.
+		 * \param      obstacle        The first vertex of the edge.
+		 * \param      minCellX        The minimum x-coordinate of the cells.
+		 * \param      minCellY        The minimum y-coordinate of the cells.
+		 * \param      maxCellX        The maximum x-coordinate of the cells.
+		 * \param      maxCellY        The maximum y-coordinate of the cells.
+		 */
+		void getEdgeCells(const Obstacle *obstacle, int &minCellX,
+						  int &minCellY, int &maxCellX, int &maxCellY) const;
+
+		/**
+		 * \brief      Inserts the edge starting at the specified vertex into
+		 *             the buckets of the cells that it overlaps.
+		 * \param      obstacle        The first vertex of the edge.
+		 */
+		void insertEdge(const Obstacle *obstacle);
+
+		/**
+		 * \brief      Moves a dynamic obstacle.
+		 * \param      obstacleNo      The number of the dynamic obstacle.
+		 * \param      displacement    The displacement of its vertices.
+		 */
+		void moveObstacle(size_t obstacleNo, const Vector2 &displacement);
+
+		/**
+		 * \brief      Queries the visibility between two points within a
+		 *             specified radius with respect to the dynamic obstacles.
+		 * \param      q1              The first point between which visibility is
+		 *                             to be tested.
+		 * \param      q2              The second point between which visibility is
+		 *                             to be tested.
+		 * \param      radius          The radius within which visibility is to be
+		 *                             tested.
+		 * \return     True if q1 and q2 are mutually visible within the radius;
+		 *             false otherwise.
+		 */
+		bool queryVisibility(const Vector2 &q1, const Vector2 &q2,
+							 float radius) const;
+
+		/**
+		 * \brief      Rebuilds the buckets for the current cell size, with a
+		 *             number of buckets that suits the number of entries.
+		 */
+		void rehash();
+
+		/**
+		 * \brief      Removes the edge starting at the specified vertex from
+		 *             the buckets of the cells that it overlaps.
+		 * \param      obstacle        The first vertex of the edge.
+		 */
+		void removeEdge(const Obstacle *obstacle);
+
+		/**
+		 * \brief      Removes a dynamic obstacle. Its vertices are kept for
+		 *             reuse, so that obstacle neighbors of agents computed
+		 *             before the removal remain valid.
+		 * \param      obstacleNo      The number of the dynamic obstacle.
+		 */
+		void removeObstacle(size_t obstacleNo);
+
+		/**
+		 * \brief      Sets the cell size of the grid.
+		 * \param      cellSize        The cell size, which must be positive.
+		 */
+		void setCellSize(float cellSize);
+
+		std::vector<std::vector<const Obstacle *> > buckets_;
+		float cellSize_;
+		std::vector<size_t> freeObstacles_;
+		float invCellSize_;
+		size_t numEntries_;
+		std::vector<size_t> numObstacleVertices_;
+		std::vector<std::vector<Obstacle *> > obstacles_;
+		RVOSimulator *sim_;
+
+		static const size_t MIN_NUM_BUCKETS = 64;
+
+		friend class Agent;
+		friend class RVOSimulator;
+	};
+}
+
+#endif /* RVO_OBSTACLE_GRID_H_ */
@@ -54,7 +54,9 @@
  (ORCA) formulation for multi-agent simulation. <b>RVO2 Library</b> automatically
  uses parallelism for computing the motion of the agents if your machine has
  multiple processors and your compiler supports <a href="http://www.openmp.org/">
- OpenMP</a>.
+ OpenMP</a>. Alternatively, RVO::RVOSimulator::setNumThreads(...) enables a
+ built-in pool of persistent threads that balance the agents among themselves
+ by work stealing.
 
  Please follow the following steps to install and use <b>RVO2 Library</b>.
 
@@ -113,6 +115,13 @@
  agent, but only relies on the preferred velocities of the agents set by the
  external application.
 
+ For the common case of agents heading to a few fixed goals around static
+ obstacles, <b>RVO2 Library</b> optionally builds goal distance fields on a
+ uniform grid: RVO::RVOSimulator::setNavigationGrid(...) defines the grid,
+ RVO::RVOSimulator::addNavigationGoal(...) builds the field of a goal once, and
+ RVO::RVOSimulator::setAgentPrefVelocitiesToGoals(...) then sets the preferred
+ velocities of all agents with a lookup per agent.
+
  \section    structure   Structure of RVO2 Library
 
  The structure of <b>RVO2 Library</b> is similar to that of %RVO Library 1.x.
@@ -335,7 +344,11 @@
  New agents can be added to the simulation at any time, but it is not allowed to
  add obstacles to the simulation after they have been processed by calling
  RVO::RVOSimulator::processObstacles(). Also, it is impossible to change the
- position of the vertices of the obstacles.
+ position of the vertices of the obstacles. Obstacles that appear, move or
+ disappear during the simulation, such as vehicles or temporary barriers, are
+ added as dynamic obstacles by RVO::RVOSimulator::addDynamicObstacle(...), moved
+ by RVO::RVOSimulator::moveDynamicObstacle(...) and removed by
+ RVO::RVOSimulator::removeDynamicObstacle(...).
 
  See the documentation of the class RVO::RVOSimulator for an exhaustive list of
  public functions for manipulating the simulation.
@@ -33,39 +33,98 @@
 #include "RVOSimulator.h"
 
 #include "Agent.h"
+#include "ApproachingAgents.h"
 #include "KdTree.h"
+#include "NavigationField.h"
 #include "Obstacle.h"
+#include "ObstacleGrid.h"
+#include "SpatialHash.h"
+#include "ThreadPool.h"
+
+#include <cstring>
 
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
 namespace RVO {
-	RVOSimulator::RVOSimulator() : defaultAgent_(NULL), globalTime_(0.0f), kdTree_(NULL), timeStep_(0.0f)
+	namespace {
+		/* Spreads the lower 16 bits of x to the even bits of the result. */
+		inline unsigned int interleaveBits(unsigned int x)
+		{
+			x &= 0x0000ffff;
+			x = (x | (x << 8)) & 0x00ff00ff;
+			x = (x | (x << 4)) & 0x0f0f0f0f;
+			x = (x | (x << 2)) & 0x33333333;
+			x = (x | (x << 1)) & 0x55555555;
+
+			return x;
+		}
+
+		/* Adds the bytes of the bit pattern of value to a 64-bit FNV-1a hash. */
+		inline void hashBits(std::uint64_t &hash, float value)
+		{
+			unsigned char bytes[sizeof(float)];
+			std::memcpy(bytes, &value, sizeof(float));
+
+			for (size_t i = 0; i < sizeof(float); ++i) {
+				hash = (hash ^ bytes[i]) * 1099511628211ULL;
+			}
+		}
+
+		/* Rearranges values so that the i-th value is the order[i]-th before. */
+		template <class T>
+		void permute(std::vector<T> &values, const std::vector<size_t> &order)
+		{
+			std::vector<T> permuted(values.size());
+
+			for (size_t i = 0; i < order.size(); ++i) {
+				permuted[i] = values[order[i]];
+			}
+
+			values.swap(permuted);
+		}
+	}
+
+	/**
+	 * \brief      Defines a task that answers the visibility queries of a
+	 *             batch, one bitmask word of queries per item.
+	 */
+	class RVOSimulator::VisibilityTask : public ThreadPool::Task {
+	public:
+		VisibilityTask(const RVOSimulator *sim, const Vector2 *points1, const Vector2 *points2, const float *radii, size_t numQueries, std::uint64_t *visibility) : numQueries_(numQueries), points1_(points1), points2_(points2), radii_(radii), sim_(sim), visibility_(visibility) { }
+
+		virtual void run(size_t begin, size_t end)
+		{
+			sim_->queryVisibilityWords(points1_, points2_, radii_, numQueries_, begin, end, visibility_);
+		}
+
+	private:
+		size_t numQueries_;
+		const Vector2 *points1_;
+		const Vector2 *points2_;
+		const float *radii_;
+		const RVOSimulator *sim_;
+		std::uint64_t *visibility_;
+	};
+
+	RVOSimulator::RVOSimulator() : agentNeighborIndex_(NULL), agentNeighborSkin_(0.0f), agentReorderInterval_(0), agentSleepSpeed_(0.0f), agentsReordered_(false), defaultProfileNo_(RVO_ERROR), defaultRadius_(0.0f), deterministic_(false), globalTime_(0.0f), hasInvalidNeighborLists_(false), kdTree_(NULL), navigationField_(NULL), numStepsSinceAgentReorder_(0), obstacleGrid_(NULL), rebuildNeighborLists_(true), recording_(false), spatialHash_(NULL), threadPool_(NULL), timeStep_(0.0f)
 	{
 		kdTree_ = new KdTree(this);
+		agentNeighborIndex_ = kdTree_;
+		obstacleGrid_ = new ObstacleGrid(this);
 	}
 
-	RVOSimulator::RVOSimulator(float timeStep, float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity) : defaultAgent_(NULL), globalTime_(0.0f), kdTree_(NULL), timeStep_(timeStep)
+	RVOSimulator::RVOSimulator(float timeStep, float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity) : agentNeighborIndex_(NULL), agentNeighborSkin_(0.0f), agentReorderInterval_(0), agentSleepSpeed_(0.0f), agentsReordered_(false), defaultProfileNo_(RVO_ERROR), defaultRadius_(radius), defaultVelocity_(velocity), deterministic_(false), globalTime_(0.0f), hasInvalidNeighborLists_(false), kdTree_(NULL), navigationField_(NULL), numStepsSinceAgentReorder_(0), obstacleGrid_(NULL), rebuildNeighborLists_(true), recording_(false), spatialHash_(NULL), threadPool_(NULL), timeStep_(timeStep)
 	{
 		kdTree_ = new KdTree(this);
-		defaultAgent_ = new Agent(this);
-
-		defaultAgent_->maxNeighbors_ = maxNeighbors;
-		defaultAgent_->maxSpeed_ = maxSpeed;
-		defaultAgent_->neighborDist_ = neighborDist;
-		defaultAgent_->radius_ = radius;
-		defaultAgent_->timeHorizon_ = timeHorizon;
-		defaultAgent_->timeHorizonObst_ = timeHorizonObst;
-		defaultAgent_->velocity_ = velocity;
+		agentNeighborIndex_ = kdTree_;
+		obstacleGrid_ = new ObstacleGrid(this);
+		defaultProfileNo_ = addProfile(neighborDist, maxNeighbors, timeHorizon, timeHorizonObst, maxSpeed);
 	}
 
 	RVOSimulator::~RVOSimulator()
 	{
-		if (defaultAgent_ != NULL) {
-			delete defaultAgent_;
-		}
-
 		for (size_t i = 0; i < agents_.size(); ++i) {
 			delete agents_[i];
 		}
@@ -75,50 +134,153 @@ namespace RVO {
 		}
 
 		delete kdTree_;
+
+		if (navigationField_ != NULL) {
+			delete navigationField_;
+		}
+
+		delete obstacleGrid_;
+
+		if (spatialHash_ != NULL) {
+			delete spatialHash_;
+		}
+
+		if (threadPool_ != NULL) {
+			delete threadPool_;
+		}
 	}
 
 	size_t RVOSimulator::addAgent(const Vector2 &position)
 	{
-		if (defaultAgent_ == NULL) {
+		if (defaultProfileNo_ == RVO_ERROR) {
+			return RVO_ERROR;
+		}
+
+		return addAgent(position, defaultProfileNo_, defaultRadius_, defaultVelocity_);
+	}
+
+	size_t RVOSimulator::addAgent(const Vector2 &position, float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity)
+	{
+		const size_t profileNo = addProfile(neighborDist, maxNeighbors, timeHorizon, timeHorizonObst, maxSpeed);
+		const size_t agentNo = addAgent(position, profileNo, radius, velocity);
+
+		/* Owned only once the agent refers to it, as addAgent takes only shared profiles. */
+		agentProfiles_[profileNo].isOwned = true;
+
+		return agentNo;
+	}
+
+	size_t RVOSimulator::addAgent(const Vector2 &position, size_t profileNo, float radius, const Vector2 &velocity)
+	{
+		if (!isSharedProfile(profileNo)) {
 			return RVO_ERROR;
 		}
 
-		Agent *agent = new Agent(this);
+		size_t agentNo;
+		size_t agentIndex;
+
+		if (freeAgents_.empty()) {
+			agentNo = agentIndices_.size();
+			agentIndex = agents_.size();
 
-		agent->position_ = position;
-		agent->maxNeighbors_ = defaultAgent_->maxNeighbors_;
-		agent->maxSpeed_ = defaultAgent_->maxSpeed_;
-		agent->neighborDist_ = defaultAgent_->neighborDist_;
-		agent->radius_ = defaultAgent_->radius_;
-		agent->timeHorizon_ = defaultAgent_->timeHorizon_;
-		agent->timeHorizonObst_ = defaultAgent_->timeHorizonObst_;
-		agent->velocity_ = defaultAgent_->velocity_;
+			agents_.push_back(new Agent(this));
+			agents_[agentIndex]->id_ = agentIndex;
 
-		agent->id_ = agents_.size();
+			agentIndices_.push_back(agentIndex);
+			agentNumbers_.push_back(agentNo);
 
-		agents_.push_back(agent);
+			agentActive_.push_back(1);
+			agentPositions_.push_back(position);
+			agentPrefVelocities_.push_back(Vector2());
+			agentRadii_.push_back(radius);
+			agentSleeping_.push_back(0);
+			agentVelocities_.push_back(velocity);
+		}
+		else {
+			/* Reuse the slot of a removed agent. */
+			agentNo = freeAgents_.back();
+			agentIndex = agentIndices_[agentNo];
+			freeAgents_.pop_back();
+
+			releaseOwnedProfile(agentIndex);
+			agents_[agentIndex]->agentNeighbors_.clear();
+			agents_[agentIndex]->obstacleNeighbors_.clear();
+			agents_[agentIndex]->orcaLines_.clear();
+			agents_[agentIndex]->newVelocity_ = Vector2();
+
+			agentActive_[agentIndex] = 1;
+			agentPositions_[agentIndex] = position;
+			agentPrefVelocities_[agentIndex] = Vector2();
+			agentRadii_[agentIndex] = radius;
+			agentSleeping_[agentIndex] = 0;
+			agentVelocities_[agentIndex] = velocity;
+		}
+
+		Agent *const agent = agents_[agentIndex];
+		agent->profileNo_ = profileNo;
+
+		/* Keep the agent neighbor buffers from growing during the simulation. */
+		if (isKeepingAgentNeighbors()) {
+			agent->agentNeighbors_.reserve(agentProfiles_[profileNo].maxNeighbors);
+		}
 
-		return agents_.size() - 1;
+		if (recording_) {
+			agent->orcaLines_.reserve(agentProfiles_[profileNo].maxNeighbors);
+		}
+
+		kdTree_->agentsChanged_ = true;
+		rebuildNeighborLists_ = true;
+
+		return agentNo;
 	}
 
-	size_t RVOSimulator::addAgent(const Vector2 &position, float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity)
+	std::vector<size_t> RVOSimulator::addAgents(const std::vector<Vector2> &positions)
 	{
-		Agent *agent = new Agent(this);
+		std::vector<size_t> agentNos;
+
+		if (defaultProfileNo_ == RVO_ERROR) {
+			return agentNos;
+		}
+
+		agentNos.reserve(positions.size());
+
+		if (positions.size() > freeAgents_.size()) {
+			const size_t numAgents = agents_.size() + positions.size() - freeAgents_.size();
+
+			agents_.reserve(numAgents);
+			agentActive_.reserve(numAgents);
+			agentIndices_.reserve(numAgents);
+			agentNumbers_.reserve(numAgents);
+			agentPositions_.reserve(numAgents);
+			agentPrefVelocities_.reserve(numAgents);
+			agentRadii_.reserve(numAgents);
+			agentSleeping_.reserve(numAgents);
+			agentVelocities_.reserve(numAgents);
+		}
+
+		for (size_t i = 0; i < positions.size(); ++i) {
+			agentNos.push_back(addAgent(positions[i]));
+		}
+
+		return agentNos;
+	}
 
-		agent->position_ = position;
-		agent->maxNeighbors_ = maxNeighbors;
-		agent->maxSpeed_ = maxSpeed;
-		agent->neighborDist_ = neighborDist;
-		agent->radius_ = radius;
-		agent->timeHorizon_ = timeHorizon;
-		agent->timeHorizonObst_ = timeHorizonObst;
-		agent->velocity_ = velocity;
+	size_t RVOSimulator::addDynamicObstacle(const std::vector<Vector2> &vertices)
+	{
+		if (vertices.size() < 2) {
+			return RVO_ERROR;
+		}
 
-		agent->id_ = agents_.size();
+		return obstacleGrid_->addObstacle(vertices);
+	}
 
-		agents_.push_back(agent);
+	size_t RVOSimulator::addNavigationGoal(const Vector2 &goal)
+	{
+		if (navigationField_ == NULL) {
+			return RVO_ERROR;
+		}
 
-		return agents_.size() - 1;
+		return navigationField_->addGoal(goal);
 	}
 
 	size_t RVOSimulator::addObstacle(const std::vector<Vector2> &vertices)
@@ -132,51 +294,151 @@ namespace RVO {
 		for (size_t i = 0; i < vertices.size(); ++i) {
 			Obstacle *obstacle = new Obstacle();
 			obstacle->point_ = vertices[i];
+			obstacle->id_ = obstacles_.size();
+
+			obstacles_.push_back(obstacle);
+		}
 
-			if (i != 0) {
-				obstacle->prevObstacle_ = obstacles_.back();
-				obstacle->prevObstacle_->nextObstacle_ = obstacle;
+		Obstacle::linkVertices(&obstacles_[obstacleNo], vertices.size());
+
+		return obstacleNo;
+	}
+
+	size_t RVOSimulator::addProfile(float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float maxSpeed)
+	{
+		AgentProfile profile;
+		profile.isFree = false;
+		profile.isOwned = false;
+		profile.maxNeighbors = maxNeighbors;
+		profile.maxSpeed = maxSpeed;
+		profile.neighborDist = neighborDist;
+		profile.timeHorizon = timeHorizon;
+		profile.timeHorizonObst = timeHorizonObst;
+
+		return storeProfile(profile);
+	}
+
+	void RVOSimulator::computeNewVelocities(size_t begin, size_t end)
+	{
+#if RVO_INSTRUMENTATION
+		StepStatistics *const statistics = &stepStatistics_[getThreadNo()];
+#endif
+		AgentScratch *const scratch = (recording_ ? NULL : &agentScratch_[getThreadNo()]);
+		const bool swapAgentNeighbors = !isKeepingAgentNeighbors();
+
+		for (size_t i = begin; i < end; ++i) {
+			if (agentActive_[i] && !agentSleeping_[i]) {
+				Agent *const agent = agents_[i];
+#if RVO_INSTRUMENTATION
+				agent->statistics_ = statistics;
+				++statistics->numAgents;
+#endif
+
+				if (scratch != NULL) {
+					swapAgentBuffers(agent, *scratch, swapAgentNeighbors);
+				}
+
+				agent->computeNeighbors();
+				agent->computeNewVelocity();
+
+				if (scratch != NULL) {
+					swapAgentBuffers(agent, *scratch, swapAgentNeighbors);
+				}
 			}
+		}
+	}
 
-			if (i == vertices.size() - 1) {
-				obstacle->nextObstacle_ = obstacles_[obstacleNo];
-				obstacle->nextObstacle_->prevObstacle_ = obstacle;
+	void RVOSimulator::doStep()
+	{
+		if (agentReorderInterval_ > 0) {
+			if (numStepsSinceAgentReorder_ == 0) {
+				reorderAgents();
 			}
 
-			obstacle->unitDir_ = normalize(vertices[(i == vertices.size() - 1 ? 0 : i + 1)] - vertices[i]);
+			numStepsSinceAgentReorder_ = (numStepsSinceAgentReorder_ + 1) % agentReorderInterval_;
+		}
+
+		if (agentSleepSpeed_ > 0.0f) {
+			const float sleepSpeedSq = sqr(agentSleepSpeed_);
 
-			if (vertices.size() == 2) {
-				obstacle->isConvex_ = true;
+			for (size_t i = 0; i < agents_.size(); ++i) {
+				if (agentSleeping_[i] && absSq(agentPrefVelocities_[i]) > sleepSpeedSq) {
+					wakeAgent(i);
+				}
 			}
-			else {
-				obstacle->isConvex_ = (leftOf(vertices[(i == 0 ? vertices.size() - 1 : i - 1)], vertices[i], vertices[(i == vertices.size() - 1 ? 0 : i + 1)]) >= 0.0f);
+		}
+
+		if (agentNeighborSkin_ > 0.0f) {
+			/*
+			 * An agent within the neighbor distance of another agent now was
+			 * within the neighbor distance plus the skin when the lists were
+			 * built, as long as neither has moved more than half the skin.
+			 */
+			const float maxDisplacementSq = sqr(0.5f * agentNeighborSkin_);
+
+			for (size_t i = 0; i < agents_.size() && !rebuildNeighborLists_; ++i) {
+				if (agentActive_[i] && absSq(agentPositions_[i] - neighborListPositions_[i]) > maxDisplacementSq) {
+					rebuildNeighborLists_ = true;
+				}
 			}
 
-			obstacle->id_ = obstacles_.size();
+			if (rebuildNeighborLists_) {
+				neighborListPositions_ = agentPositions_;
+				hasInvalidNeighborLists_ = false;
+			}
+		}
 
-			obstacles_.push_back(obstacle);
+		if (!recording_ && agentScratch_.size() < getNumWorkerThreads()) {
+			agentScratch_.resize(getNumWorkerThreads());
 		}
 
-		return obstacleNo;
-	}
+#if RVO_INSTRUMENTATION
+		stepStatistics_.assign(getNumWorkerThreads(), StepStatistics());
+		const double buildStartTime = getWallTime();
+#endif
 
-	void RVOSimulator::doStep()
-	{
-		kdTree_->buildAgentTree();
+		/*
+		 * Between rebuilds of the agent neighbor lists, the index is only used
+		 * by the agents that have woken up since the last rebuild.
+		 */
+		if (agentNeighborSkin_ == 0.0f || rebuildNeighborLists_ || hasInvalidNeighborLists_) {
+			agentNeighborIndex_->buildAgentIndex();
+		}
 
+#if RVO_INSTRUMENTATION
+		stepStatistics_[0].phaseTimes[RVO_PHASE_BUILD_AGENT_INDEX] += getWallTime() - buildStartTime;
+#endif
+
+		if (threadPool_ != NULL) {
+			ThreadPool::MemberTask<RVOSimulator, &RVOSimulator::computeNewVelocities> computeTask(this);
+			threadPool_->parallelFor(agents_.size(), AGENT_CHUNK_SIZE, computeTask);
+		}
+		else {
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-		for (int i = 0; i < static_cast<int>(agents_.size()); ++i) {
-			agents_[i]->computeNeighbors();
-			agents_[i]->computeNewVelocity();
+			for (int i = 0; i < static_cast<int>(agents_.size()); ++i) {
+				computeNewVelocities(static_cast<size_t>(i), static_cast<size_t>(i) + 1);
+			}
 		}
 
+		rebuildNeighborLists_ = false;
+
+		if (agentSleepSpeed_ > 0.0f) {
+			updateSleepingAgents();
+		}
+
+		if (threadPool_ != NULL) {
+			ThreadPool::MemberTask<RVOSimulator, &RVOSimulator::updateAgents> updateTask(this);
+			threadPool_->parallelFor(agents_.size(), AGENT_CHUNK_SIZE, updateTask);
+		}
+		else {
 #ifdef _OPENMP
 #pragma omp parallel for
 #endif
-		for (int i = 0; i < static_cast<int>(agents_.size()); ++i) {
-			agents_[i]->update();
+			for (int i = 0; i < static_cast<int>(agents_.size()); ++i) {
+				updateAgents(static_cast<size_t>(i), static_cast<size_t>(i) + 1);
+			}
 		}
 
 		globalTime_ += timeStep_;
@@ -184,77 +446,144 @@ namespace RVO {
 
 	size_t RVOSimulator::getAgentAgentNeighbor(size_t agentNo, size_t neighborNo) const
 	{
-		return agents_[agentNo]->agentNeighbors_[neighborNo].second->id_;
+		return agentNumbers_[agents_[agentIndices_[agentNo]]->agentNeighbors_[neighborNo].second];
 	}
 
 	size_t RVOSimulator::getAgentMaxNeighbors(size_t agentNo) const
 	{
-		return agents_[agentNo]->maxNeighbors_;
+		return agentProfiles_[agents_[agentIndices_[agentNo]]->profileNo_].maxNeighbors;
 	}
 
 	float RVOSimulator::getAgentMaxSpeed(size_t agentNo) const
 	{
-		return agents_[agentNo]->maxSpeed_;
+		return agentProfiles_[agents_[agentIndices_[agentNo]]->profileNo_].maxSpeed;
 	}
 
 	float RVOSimulator::getAgentNeighborDist(size_t agentNo) const
 	{
-		return agents_[agentNo]->neighborDist_;
+		return agentProfiles_[agents_[agentIndices_[agentNo]]->profileNo_].neighborDist;
+	}
+
+	NeighborIndexType RVOSimulator::getAgentNeighborIndex() const
+	{
+		return (agentNeighborIndex_ == spatialHash_ ? RVO_SPATIAL_HASH : RVO_KD_TREE);
+	}
+
+	float RVOSimulator::getAgentNeighborSkin() const
+	{
+		return agentNeighborSkin_;
 	}
 
 	size_t RVOSimulator::getAgentNumAgentNeighbors(size_t agentNo) const
 	{
-		return agents_[agentNo]->agentNeighbors_.size();
+		return agents_[agentIndices_[agentNo]]->agentNeighbors_.size();
 	}
 
 	size_t RVOSimulator::getAgentNumObstacleNeighbors(size_t agentNo) const
 	{
-		return agents_[agentNo]->obstacleNeighbors_.size();
+		return agents_[agentIndices_[agentNo]]->obstacleNeighbors_.size();
 	}
 
 	size_t RVOSimulator::getAgentNumORCALines(size_t agentNo) const
 	{
-		return agents_[agentNo]->orcaLines_.size();
+		return agents_[agentIndices_[agentNo]]->orcaLines_.size();
 	}
 
 	size_t RVOSimulator::getAgentObstacleNeighbor(size_t agentNo, size_t neighborNo) const
 	{
-		return agents_[agentNo]->obstacleNeighbors_[neighborNo].second->id_;
+		return agents_[agentIndices_[agentNo]]->obstacleNeighbors_[neighborNo].second->id_;
 	}
 
 	const Line &RVOSimulator::getAgentORCALine(size_t agentNo, size_t lineNo) const
 	{
-		return agents_[agentNo]->orcaLines_[lineNo];
+		return agents_[agentIndices_[agentNo]]->orcaLines_[lineNo];
 	}
 
 	const Vector2 &RVOSimulator::getAgentPosition(size_t agentNo) const
 	{
-		return agents_[agentNo]->position_;
+		return agentPositions_[agentIndices_[agentNo]];
+	}
+
+	const std::vector<Vector2> &RVOSimulator::getAgentPositions() const
+	{
+		if (!agentsReordered_) {
+			return agentPositions_;
+		}
+
+		agentPositionBuffer_.resize(agentIndices_.size());
+
+		for (size_t i = 0; i < agentIndices_.size(); ++i) {
+			agentPositionBuffer_[i] = agentPositions_[agentIndices_[i]];
+		}
+
+		return agentPositionBuffer_;
 	}
 
 	const Vector2 &RVOSimulator::getAgentPrefVelocity(size_t agentNo) const
 	{
-		return agents_[agentNo]->prefVelocity_;
+		return agentPrefVelocities_[agentIndices_[agentNo]];
+	}
+
+	size_t RVOSimulator::getAgentProfile(size_t agentNo) const
+	{
+		const size_t profileNo = agents_[agentIndices_[agentNo]]->profileNo_;
+
+		return (agentProfiles_[profileNo].isOwned ? RVO_ERROR : profileNo);
 	}
 
 	float RVOSimulator::getAgentRadius(size_t agentNo) const
 	{
-		return agents_[agentNo]->radius_;
+		return agentRadii_[agentIndices_[agentNo]];
+	}
+
+	size_t RVOSimulator::getAgentReorderInterval() const
+	{
+		return agentReorderInterval_;
+	}
+
+	float RVOSimulator::getAgentSleepSpeed() const
+	{
+		return agentSleepSpeed_;
 	}
 
 	float RVOSimulator::getAgentTimeHorizon(size_t agentNo) const
 	{
-		return agents_[agentNo]->timeHorizon_;
+		return agentProfiles_[agents_[agentIndices_[agentNo]]->profileNo_].timeHorizon;
 	}
 
 	float RVOSimulator::getAgentTimeHorizonObst(size_t agentNo) const
 	{
-		return agents_[agentNo]->timeHorizonObst_;
+		return agentProfiles_[agents_[agentIndices_[agentNo]]->profileNo_].timeHorizonObst;
+	}
+
+	float RVOSimulator::getAgentTreeRefitThreshold() const
+	{
+		return kdTree_->agentTreeRefitThreshold_;
 	}
 
 	const Vector2 &RVOSimulator::getAgentVelocity(size_t agentNo) const
 	{
-		return agents_[agentNo]->velocity_;
+		return agentVelocities_[agentIndices_[agentNo]];
+	}
+
+	const std::vector<Vector2> &RVOSimulator::getAgentVelocities() const
+	{
+		if (!agentsReordered_) {
+			return agentVelocities_;
+		}
+
+		agentVelocityBuffer_.resize(agentIndices_.size());
+
+		for (size_t i = 0; i < agentIndices_.size(); ++i) {
+			agentVelocityBuffer_[i] = agentVelocities_[agentIndices_[i]];
+		}
+
+		return agentVelocityBuffer_;
+	}
+
+	float RVOSimulator::getDynamicObstacleCellSize() const
+	{
+		return obstacleGrid_->cellSize_;
 	}
 
 	float RVOSimulator::getGlobalTime() const
@@ -262,9 +591,43 @@ namespace RVO {
 		return globalTime_;
 	}
 
+	Vector2 RVOSimulator::getNavigationDirection(size_t goalNo, const Vector2 &point) const
+	{
+		return navigationField_->getDirection(goalNo, point);
+	}
+
+	float RVOSimulator::getNavigationDistance(size_t goalNo, const Vector2 &point) const
+	{
+		return navigationField_->getDistance(goalNo, point);
+	}
+
 	size_t RVOSimulator::getNumAgents() const
 	{
-		return agents_.size();
+		return agentIndices_.size();
+	}
+
+	size_t RVOSimulator::getNumLinearProgram3Fallbacks() const
+	{
+		size_t numFallbacks = 0;
+
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			numFallbacks += agents_[i]->numLinearProgram3Fallbacks_;
+		}
+
+		return numFallbacks;
+	}
+
+	size_t RVOSimulator::getNumWorkerThreads() const
+	{
+		if (threadPool_ != NULL) {
+			return threadPool_->getNumThreads();
+		}
+
+#ifdef _OPENMP
+		return static_cast<size_t>(omp_get_max_threads());
+#else
+		return 1;
+#endif
 	}
 
 	size_t RVOSimulator::getNumObstacleVertices() const
@@ -272,6 +635,11 @@ namespace RVO {
 		return obstacles_.size();
 	}
 
+	size_t RVOSimulator::getNumThreads() const
+	{
+		return (threadPool_ != NULL ? threadPool_->getNumThreads() : 0);
+	}
+
 	const Vector2 &RVOSimulator::getObstacleVertex(size_t vertexNo) const
 	{
 		return obstacles_[vertexNo]->point_;
@@ -282,16 +650,146 @@ namespace RVO {
 		return obstacles_[vertexNo]->nextObstacle_->id_;
 	}
 
+	RVOSimulator::AgentProfile &RVOSimulator::getOwnedProfile(size_t agentIndex)
+	{
+		Agent *const agent = agents_[agentIndex];
+
+		if (!agentProfiles_[agent->profileNo_].isOwned) {
+			AgentProfile profile = agentProfiles_[agent->profileNo_];
+			profile.isOwned = true;
+			agent->profileNo_ = storeProfile(profile);
+		}
+
+		return agentProfiles_[agent->profileNo_];
+	}
+
 	size_t RVOSimulator::getPrevObstacleVertexNo(size_t vertexNo) const
 	{
 		return obstacles_[vertexNo]->prevObstacle_->id_;
 	}
 
+	size_t RVOSimulator::getProfileMaxNeighbors(size_t profileNo) const
+	{
+		return agentProfiles_[profileNo].maxNeighbors;
+	}
+
+	float RVOSimulator::getProfileMaxSpeed(size_t profileNo) const
+	{
+		return agentProfiles_[profileNo].maxSpeed;
+	}
+
+	float RVOSimulator::getProfileNeighborDist(size_t profileNo) const
+	{
+		return agentProfiles_[profileNo].neighborDist;
+	}
+
+	float RVOSimulator::getProfileTimeHorizon(size_t profileNo) const
+	{
+		return agentProfiles_[profileNo].timeHorizon;
+	}
+
+	float RVOSimulator::getProfileTimeHorizonObst(size_t profileNo) const
+	{
+		return agentProfiles_[profileNo].timeHorizonObst;
+	}
+
+	std::uint64_t RVOSimulator::getStateHash() const
+	{
+		std::uint64_t hash = 14695981039346656037ULL;
+
+		hashBits(hash, globalTime_);
+
+		for (size_t i = 0; i < agentIndices_.size(); ++i) {
+			const size_t agentIndex = agentIndices_[i];
+
+			hash = (hash ^ static_cast<std::uint64_t>(agentActive_[agentIndex] != 0)) * 1099511628211ULL;
+			hashBits(hash, agentPositions_[agentIndex].x());
+			hashBits(hash, agentPositions_[agentIndex].y());
+			hashBits(hash, agentVelocities_[agentIndex].x());
+			hashBits(hash, agentVelocities_[agentIndex].y());
+		}
+
+		return hash;
+	}
+
+	const std::vector<StepStatistics> &RVOSimulator::getStepStatistics() const
+	{
+		return stepStatistics_;
+	}
+
+	size_t RVOSimulator::getThreadNo() const
+	{
+		if (threadPool_ != NULL) {
+			return ThreadPool::getThreadNo();
+		}
+
+#ifdef _OPENMP
+		return static_cast<size_t>(omp_get_thread_num());
+#else
+		return 0;
+#endif
+	}
+
 	float RVOSimulator::getTimeStep() const
 	{
 		return timeStep_;
 	}
 
+	StepStatistics RVOSimulator::getTotalStepStatistics() const
+	{
+		StepStatistics total;
+
+		for (size_t i = 0; i < stepStatistics_.size(); ++i) {
+			total.numAgentIndexNodeVisits += stepStatistics_[i].numAgentIndexNodeVisits;
+			total.numAgentNeighbors += stepStatistics_[i].numAgentNeighbors;
+			total.numAgents += stepStatistics_[i].numAgents;
+			total.numLinearProgram3Fallbacks += stepStatistics_[i].numLinearProgram3Fallbacks;
+			total.numObstacleNeighbors += stepStatistics_[i].numObstacleNeighbors;
+			total.numObstacleTreeNodeVisits += stepStatistics_[i].numObstacleTreeNodeVisits;
+
+			for (size_t j = 0; j < RVO_NUM_STEP_PHASES; ++j) {
+				total.phaseTimes[j] += stepStatistics_[i].phaseTimes[j];
+			}
+		}
+
+		return total;
+	}
+
+	bool RVOSimulator::isAgentActive(size_t agentNo) const
+	{
+		return agentActive_[agentIndices_[agentNo]] != 0;
+	}
+
+	bool RVOSimulator::isAgentSleeping(size_t agentNo) const
+	{
+		return agentSleeping_[agentIndices_[agentNo]] != 0;
+	}
+
+	bool RVOSimulator::isDeterministic() const
+	{
+		return deterministic_;
+	}
+
+	bool RVOSimulator::isKeepingAgentNeighbors() const
+	{
+		return recording_ || agentNeighborSkin_ > 0.0f || agentSleepSpeed_ > 0.0f;
+	}
+
+	bool RVOSimulator::isRecording() const
+	{
+		return recording_;
+	}
+
+	bool RVOSimulator::isSharedProfile(size_t profileNo) const
+	{
+		return profileNo < agentProfiles_.size() && !agentProfiles_[profileNo].isFree && !agentProfiles_[profileNo].isOwned;
+	}
+
+	void RVOSimulator::moveDynamicObstacle(size_t obstacleNo, const Vector2 &displacement)
+	{
+		obstacleGrid_->moveObstacle(obstacleNo, displacement);
+	}
+
 	void RVOSimulator::processObstacles()
 	{
 		kdTree_->buildObstacleTree();
@@ -299,71 +797,551 @@ namespace RVO {
 
 	bool RVOSimulator::queryVisibility(const Vector2 &point1, const Vector2 &point2, float radius) const
 	{
-		return kdTree_->queryVisibility(point1, point2, radius);
+		return kdTree_->queryVisibility(point1, point2, radius) && obstacleGrid_->queryVisibility(point1, point2, radius);
 	}
 
-	void RVOSimulator::setAgentDefaults(float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity)
+	void RVOSimulator::queryVisibility(const std::vector<Vector2> &points1, const std::vector<Vector2> &points2, const std::vector<float> &radii, std::vector<std::uint64_t> &visibility) const
+	{
+		const size_t numQueries = points1.size();
+		const size_t numWords = (numQueries + 63) / 64;
+
+		visibility.assign(numWords, 0);
+
+		if (numQueries == 0) {
+			return;
+		}
+
+		if (threadPool_ != NULL) {
+			VisibilityTask task(this, &points1[0], &points2[0], &radii[0], numQueries, &visibility[0]);
+			threadPool_->parallelFor(numWords, VISIBILITY_CHUNK_SIZE, task);
+		}
+		else {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+			for (int i = 0; i < static_cast<int>(numWords); ++i) {
+				queryVisibilityWords(&points1[0], &points2[0], &radii[0], numQueries, static_cast<size_t>(i), static_cast<size_t>(i) + 1, &visibility[0]);
+			}
+		}
+	}
+
+	void RVOSimulator::queryVisibilityWords(const Vector2 *points1, const Vector2 *points2, const float *radii, size_t numQueries, size_t begin, size_t end, std::uint64_t *visibility) const
+	{
+		for (size_t i = begin; i < end; ++i) {
+			std::uint64_t word = 0;
+
+			for (size_t j = 64 * i; j < numQueries && j < 64 * (i + 1); j += KdTree::VISIBILITY_PACKET_SIZE) {
+				const size_t numPacketQueries = (numQueries - j < KdTree::VISIBILITY_PACKET_SIZE ? numQueries - j : KdTree::VISIBILITY_PACKET_SIZE);
+				unsigned int packet = kdTree_->queryVisibilityPacket(points1 + j, points2 + j, radii + j, numPacketQueries);
+
+				for (size_t k = 0; k < numPacketQueries; ++k) {
+					if ((packet & (1u << k)) != 0 && !obstacleGrid_->queryVisibility(points1[j + k], points2[j + k], radii[j + k])) {
+						packet &= ~(1u << k);
+					}
+				}
+
+				word |= static_cast<std::uint64_t>(packet) << (j - 64 * i);
+			}
+
+			visibility[i] = word;
+		}
+	}
+
+	void RVOSimulator::releaseAgentBuffers()
+	{
+		if (recording_) {
+			return;
+		}
+
+		const bool keepAgentNeighbors = isKeepingAgentNeighbors();
+
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			Agent *const agent = agents_[i];
+
+			if (!keepAgentNeighbors) {
+				std::vector<std::pair<float, size_t> >().swap(agent->agentNeighbors_);
+			}
+
+			std::vector<std::pair<float, const Obstacle *> >().swap(agent->obstacleNeighbors_);
+			std::vector<Line>().swap(agent->orcaLines_);
+			std::vector<Line>().swap(agent->projLines_);
+		}
+	}
+
+	void RVOSimulator::releaseOwnedProfile(size_t agentIndex)
+	{
+		const size_t profileNo = agents_[agentIndex]->profileNo_;
+
+		if (agentProfiles_[profileNo].isOwned) {
+			agentProfiles_[profileNo].isFree = true;
+			agentProfiles_[profileNo].isOwned = false;
+			freeProfiles_.push_back(profileNo);
+		}
+	}
+
+	void RVOSimulator::reorderAgents()
+	{
+		float minX = std::numeric_limits<float>::max();
+		float minY = std::numeric_limits<float>::max();
+		float maxX = -std::numeric_limits<float>::max();
+		float maxY = -std::numeric_limits<float>::max();
+
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			if (agentActive_[i]) {
+				minX = std::min(minX, agentPositions_[i].x());
+				minY = std::min(minY, agentPositions_[i].y());
+				maxX = std::max(maxX, agentPositions_[i].x());
+				maxY = std::max(maxY, agentPositions_[i].y());
+			}
+		}
+
+		/*
+		 * Sort the active agents by the Morton code of their position on a
+		 * 65536 x 65536 grid over their bounding box. Inactive agents and the
+		 * slots of removed agents follow in their present order.
+		 */
+		const float scaleX = (maxX > minX ? 65535.0f / (maxX - minX) : 0.0f);
+		const float scaleY = (maxY > minY ? 65535.0f / (maxY - minY) : 0.0f);
+
+		std::vector<std::pair<unsigned int, size_t> > mortonCodes;
+		mortonCodes.reserve(agents_.size());
+
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			if (agentActive_[i]) {
+				const unsigned int x = static_cast<unsigned int>((agentPositions_[i].x() - minX) * scaleX);
+				const unsigned int y = static_cast<unsigned int>((agentPositions_[i].y() - minY) * scaleY);
+
+				mortonCodes.push_back(std::make_pair(interleaveBits(x) | (interleaveBits(y) << 1), i));
+			}
+		}
+
+		std::sort(mortonCodes.begin(), mortonCodes.end());
+
+		std::vector<size_t> order(agents_.size());
+		size_t numOrdered = 0;
+
+		for (size_t i = 0; i < mortonCodes.size(); ++i) {
+			order[numOrdered++] = mortonCodes[i].second;
+		}
+
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			if (!agentActive_[i]) {
+				order[numOrdered++] = i;
+			}
+		}
+
+		permute(agentActive_, order);
+		permute(agentNumbers_, order);
+		permute(agentPositions_, order);
+		permute(agentPrefVelocities_, order);
+		permute(agentRadii_, order);
+		permute(agentSleeping_, order);
+		permute(agentVelocities_, order);
+		permute(agents_, order);
+
+		std::vector<size_t> newIndices(agents_.size());
+		agentsReordered_ = false;
+
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			newIndices[order[i]] = i;
+			agents_[i]->id_ = i;
+			agentIndices_[agentNumbers_[i]] = i;
+
+			if (agentNumbers_[i] != i) {
+				agentsReordered_ = true;
+			}
+		}
+
+		/*
+		 * Keep the agent neighbors of the previous step valid for queries, and
+		 * the agent neighbor lists valid for the next step.
+		 */
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			std::vector<std::pair<float, size_t> > &agentNeighbors = agents_[i]->agentNeighbors_;
+
+			for (size_t j = 0; j < agentNeighbors.size(); ++j) {
+				agentNeighbors[j].second = newIndices[agentNeighbors[j].second];
+			}
+
+			std::vector<std::pair<float, size_t> > &neighborList = agents_[i]->neighborList_;
+
+			for (size_t j = 0; j < neighborList.size(); ++j) {
+				neighborList[j].second = newIndices[neighborList[j].second];
+			}
+		}
+
+		if (neighborListPositions_.size() == agents_.size()) {
+			permute(neighborListPositions_, order);
+		}
+
+		/* The agent kd-tree is rebuilt in the new order. */
+		kdTree_->agents_.clear();
+		kdTree_->agentsChanged_ = true;
+	}
+
+	void RVOSimulator::removeAgent(size_t agentNo)
+	{
+		agentActive_[agentIndices_[agentNo]] = 0;
+		freeAgents_.push_back(agentNo);
+
+		kdTree_->agentsChanged_ = true;
+		rebuildNeighborLists_ = true;
+	}
+
+	void RVOSimulator::removeDynamicObstacle(size_t obstacleNo)
+	{
+		obstacleGrid_->removeObstacle(obstacleNo);
+	}
+
+	void RVOSimulator::setAgentActive(size_t agentNo, bool active)
 	{
-		if (defaultAgent_ == NULL) {
-			defaultAgent_ = new Agent(this);
+		const size_t agentIndex = agentIndices_[agentNo];
+
+		if ((agentActive_[agentIndex] != 0) != active) {
+			agentActive_[agentIndex] = active;
+			agentSleeping_[agentIndex] = 0;
+			kdTree_->agentsChanged_ = true;
+			rebuildNeighborLists_ = true;
 		}
+	}
 
-		defaultAgent_->maxNeighbors_ = maxNeighbors;
-		defaultAgent_->maxSpeed_ = maxSpeed;
-		defaultAgent_->neighborDist_ = neighborDist;
-		defaultAgent_->radius_ = radius;
-		defaultAgent_->timeHorizon_ = timeHorizon;
-		defaultAgent_->timeHorizonObst_ = timeHorizonObst;
-		defaultAgent_->velocity_ = velocity;
+	void RVOSimulator::setAgentDefaults(float neighborDist, size_t maxNeighbors, float timeHorizon, float timeHorizonObst, float radius, float maxSpeed, const Vector2 &velocity)
+	{
+		defaultProfileNo_ = addProfile(neighborDist, maxNeighbors, timeHorizon, timeHorizonObst, maxSpeed);
+		defaultRadius_ = radius;
+		defaultVelocity_ = velocity;
 	}
 
 	void RVOSimulator::setAgentMaxNeighbors(size_t agentNo, size_t maxNeighbors)
 	{
-		agents_[agentNo]->maxNeighbors_ = maxNeighbors;
+		Agent *const agent = agents_[agentIndices_[agentNo]];
+
+		getOwnedProfile(agent->id_).maxNeighbors = maxNeighbors;
+
+		if (isKeepingAgentNeighbors()) {
+			agent->agentNeighbors_.reserve(maxNeighbors);
+		}
+
+		if (recording_) {
+			agent->orcaLines_.reserve(maxNeighbors);
+		}
+
+		rebuildNeighborLists_ = true;
 	}
 
 	void RVOSimulator::setAgentMaxSpeed(size_t agentNo, float maxSpeed)
 	{
-		agents_[agentNo]->maxSpeed_ = maxSpeed;
+		getOwnedProfile(agentIndices_[agentNo]).maxSpeed = maxSpeed;
 	}
 
 	void RVOSimulator::setAgentNeighborDist(size_t agentNo, float neighborDist)
 	{
-		agents_[agentNo]->neighborDist_ = neighborDist;
+		getOwnedProfile(agentIndices_[agentNo]).neighborDist = neighborDist;
+		rebuildNeighborLists_ = true;
+	}
+
+	void RVOSimulator::setAgentNeighborIndex(NeighborIndexType type)
+	{
+		if (type == RVO_SPATIAL_HASH) {
+			if (spatialHash_ == NULL) {
+				spatialHash_ = new SpatialHash(this);
+			}
+
+			agentNeighborIndex_ = spatialHash_;
+		}
+		else {
+			agentNeighborIndex_ = kdTree_;
+		}
+	}
+
+	void RVOSimulator::setAgentNeighborSkin(float skin)
+	{
+		agentNeighborSkin_ = skin;
+		rebuildNeighborLists_ = true;
+		releaseAgentBuffers();
 	}
 
 	void RVOSimulator::setAgentPosition(size_t agentNo, const Vector2 &position)
 	{
-		agents_[agentNo]->position_ = position;
+		agentPositions_[agentIndices_[agentNo]] = position;
+		wakeAgent(agentIndices_[agentNo]);
+	}
+
+	void RVOSimulator::setAgentPrefVelocities(const std::vector<Vector2> &prefVelocities)
+	{
+		if (prefVelocities.size() != agentIndices_.size()) {
+			return;
+		}
+
+		if (!agentsReordered_) {
+			std::copy(prefVelocities.begin(), prefVelocities.end(), agentPrefVelocities_.begin());
+		}
+		else {
+			for (size_t i = 0; i < prefVelocities.size(); ++i) {
+				agentPrefVelocities_[agentIndices_[i]] = prefVelocities[i];
+			}
+		}
+	}
+
+	void RVOSimulator::setAgentPrefVelocitiesToGoals(const std::vector<size_t> &goalNos)
+	{
+		navigationField_->setAgentPrefVelocities(goalNos);
+	}
+
+	void RVOSimulator::setAgentProfile(size_t agentNo, size_t profileNo)
+	{
+		if (!isSharedProfile(profileNo)) {
+			return;
+		}
+
+		const size_t agentIndex = agentIndices_[agentNo];
+		Agent *const agent = agents_[agentIndex];
+
+		releaseOwnedProfile(agentIndex);
+		agent->profileNo_ = profileNo;
+
+		if (isKeepingAgentNeighbors()) {
+			agent->agentNeighbors_.reserve(agentProfiles_[profileNo].maxNeighbors);
+		}
+
+		if (recording_) {
+			agent->orcaLines_.reserve(agentProfiles_[profileNo].maxNeighbors);
+		}
+
+		rebuildNeighborLists_ = true;
 	}
 
 	void RVOSimulator::setAgentPrefVelocity(size_t agentNo, const Vector2 &prefVelocity)
 	{
-		agents_[agentNo]->prefVelocity_ = prefVelocity;
+		agentPrefVelocities_[agentIndices_[agentNo]] = prefVelocity;
 	}
 
 	void RVOSimulator::setAgentRadius(size_t agentNo, float radius)
 	{
-		agents_[agentNo]->radius_ = radius;
+		agentRadii_[agentIndices_[agentNo]] = radius;
+	}
+
+	void RVOSimulator::setAgentReorderInterval(size_t numSteps)
+	{
+		agentReorderInterval_ = numSteps;
+		numStepsSinceAgentReorder_ = 0;
+	}
+
+	void RVOSimulator::setAgentSleepSpeed(float speed)
+	{
+		agentSleepSpeed_ = speed;
+
+		if (agentSleepSpeed_ == 0.0f) {
+			for (size_t i = 0; i < agents_.size(); ++i) {
+				wakeAgent(i);
+			}
+		}
+
+		releaseAgentBuffers();
 	}
 
 	void RVOSimulator::setAgentTimeHorizon(size_t agentNo, float timeHorizon)
 	{
-		agents_[agentNo]->timeHorizon_ = timeHorizon;
+		getOwnedProfile(agentIndices_[agentNo]).timeHorizon = timeHorizon;
 	}
 
 	void RVOSimulator::setAgentTimeHorizonObst(size_t agentNo, float timeHorizonObst)
 	{
-		agents_[agentNo]->timeHorizonObst_ = timeHorizonObst;
+		getOwnedProfile(agentIndices_[agentNo]).timeHorizonObst = timeHorizonObst;
+	}
+
+	void RVOSimulator::setAgentTreeRefitThreshold(float threshold)
+	{
+		kdTree_->agentTreeRefitThreshold_ = threshold;
 	}
 
 	void RVOSimulator::setAgentVelocity(size_t agentNo, const Vector2 &velocity)
 	{
-		agents_[agentNo]->velocity_ = velocity;
+		agentVelocities_[agentIndices_[agentNo]] = velocity;
+		wakeAgent(agentIndices_[agentNo]);
+	}
+
+	void RVOSimulator::setDeterministic(bool deterministic)
+	{
+		deterministic_ = deterministic;
+	}
+
+	void RVOSimulator::setDynamicObstacleCellSize(float cellSize)
+	{
+		obstacleGrid_->setCellSize(cellSize);
+	}
+
+	void RVOSimulator::setNavigationGrid(const Vector2 &minCorner, const Vector2 &maxCorner, float cellSize, float radius)
+	{
+		if (navigationField_ != NULL) {
+			delete navigationField_;
+		}
+
+		navigationField_ = new NavigationField(this, minCorner, maxCorner, cellSize, radius);
+	}
+
+	void RVOSimulator::setNumThreads(size_t numThreads)
+	{
+		if (threadPool_ != NULL) {
+			delete threadPool_;
+			threadPool_ = NULL;
+		}
+
+		if (numThreads > 0) {
+			threadPool_ = new ThreadPool(numThreads);
+		}
+	}
+
+	void RVOSimulator::setProfileMaxNeighbors(size_t profileNo, size_t maxNeighbors)
+	{
+		agentProfiles_[profileNo].maxNeighbors = maxNeighbors;
+		rebuildNeighborLists_ = true;
+	}
+
+	void RVOSimulator::setProfileMaxSpeed(size_t profileNo, float maxSpeed)
+	{
+		agentProfiles_[profileNo].maxSpeed = maxSpeed;
+	}
+
+	void RVOSimulator::setProfileNeighborDist(size_t profileNo, float neighborDist)
+	{
+		agentProfiles_[profileNo].neighborDist = neighborDist;
+		rebuildNeighborLists_ = true;
+	}
+
+	void RVOSimulator::setProfileTimeHorizon(size_t profileNo, float timeHorizon)
+	{
+		agentProfiles_[profileNo].timeHorizon = timeHorizon;
+	}
+
+	void RVOSimulator::setProfileTimeHorizonObst(size_t profileNo, float timeHorizonObst)
+	{
+		agentProfiles_[profileNo].timeHorizonObst = timeHorizonObst;
+	}
+
+	void RVOSimulator::setRecording(bool recording)
+	{
+		recording_ = recording;
+		releaseAgentBuffers();
 	}
 
 	void RVOSimulator::setTimeStep(float timeStep)
 	{
 		timeStep_ = timeStep;
 	}
+
+	size_t RVOSimulator::storeProfile(const AgentProfile &profile)
+	{
+		if (freeProfiles_.empty()) {
+			agentProfiles_.push_back(profile);
+
+			return agentProfiles_.size() - 1;
+		}
+
+		const size_t profileNo = freeProfiles_.back();
+		freeProfiles_.pop_back();
+		agentProfiles_[profileNo] = profile;
+
+		return profileNo;
+	}
+
+	void RVOSimulator::swapAgentBuffers(Agent *agent, AgentScratch &scratch, bool agentNeighbors)
+	{
+		if (agentNeighbors) {
+			agent->agentNeighbors_.swap(scratch.agentNeighbors);
+		}
+
+		agent->obstacleNeighbors_.swap(scratch.obstacleNeighbors);
+		agent->orcaLines_.swap(scratch.orcaLines);
+		agent->projLines_.swap(scratch.projLines);
+	}
+
+	void RVOSimulator::updateAgents(size_t begin, size_t end)
+	{
+#if RVO_INSTRUMENTATION
+		const double startTime = getWallTime();
+#endif
+
+		for (size_t i = begin; i < end; ++i) {
+			if (agentActive_[i] && !agentSleeping_[i]) {
+				agents_[i]->update();
+			}
+		}
+
+#if RVO_INSTRUMENTATION
+		stepStatistics_[getThreadNo()].phaseTimes[RVO_PHASE_UPDATE] += getWallTime() - startTime;
+#endif
+	}
+
+	void RVOSimulator::updateSleepingAgents()
+	{
+		const float sleepSpeedSq = sqr(agentSleepSpeed_);
+
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			if (!agentActive_[i] || agentSleeping_[i]) {
+				continue;
+			}
+
+			Agent *const agent = agents_[i];
+
+			if (absSq(agentPrefVelocities_[i]) > sleepSpeedSq || absSq(agent->newVelocity_) > sleepSpeedSq) {
+				continue;
+			}
+
+			bool isApproached = false;
+
+			for (size_t j = 0; j < agent->agentNeighbors_.size() && !isApproached; ++j) {
+				const size_t other = agent->agentNeighbors_[j].second;
+				const Vector2 &otherVelocity = agents_[other]->newVelocity_;
+
+				isApproached = !agentSleeping_[other] && absSq(otherVelocity) > sleepSpeedSq && otherVelocity * (agentPositions_[i] - agentPositions_[other]) > 0.0f;
+			}
+
+			if (!isApproached) {
+				/* The agent stops where it is and is skipped by updateAgents(). */
+				agentSleeping_[i] = 1;
+				agentVelocities_[i] = Vector2();
+				agent->newVelocity_ = Vector2();
+			}
+		}
+
+		/*
+		 * The sleeping agents are woken up only after all agents have decided,
+		 * which keeps the agents that wake up in this step from falling asleep
+		 * again on their neighbors of before they slept. Each sleeping agent
+		 * queries the index over its own neighbor distance, as a moving agent
+		 * may approach it without having it among its nearest neighbors.
+		 * Between rebuilds of the agent neighbor lists, the index holds the
+		 * agents where they were up to half the skin away.
+		 */
+		const float indexSlack = 0.5f * agentNeighborSkin_;
+
+		for (size_t i = 0; i < agents_.size(); ++i) {
+			if (!agentActive_[i] || !agentSleeping_[i]) {
+				continue;
+			}
+
+			ApproachingAgents approachingAgents(this, i, sleepSpeedSq);
+			agentNeighborIndex_->computeApproachingAgents(agents_[i], approachingAgents, sqr(agentProfiles_[agents_[i]->profileNo_].neighborDist + indexSlack));
+
+			if (approachingAgents.isApproached_) {
+				wakeAgent(i);
+			}
+		}
+	}
+
+	void RVOSimulator::wakeAgent(size_t agentIndex)
+	{
+		if (agentSleeping_[agentIndex]) {
+			agentSleeping_[agentIndex] = 0;
+
+			/*
+			 * The agent neighbor list of the agent is not kept up to date while
+			 * it sleeps, so it queries the agent neighbor index until the lists
+			 * are rebuilt.
+			 */
+			agents_[agentIndex]->neighborListValid_ = false;
+			hasInvalidNeighborLists_ = true;
+		}
+	}
 }
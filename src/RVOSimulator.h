@@ -39,6 +39,7 @@
  */
 
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <vector>
 
@@ -69,9 +70,139 @@ namespace RVO {
 		Vector2 direction;
 	};
 
+	/**
+	 * \brief      Defines the spatial data structures that can answer the
+	 *             agent neighbor queries of the simulation.
+	 */
+	enum NeighborIndexType {
+		/**
+		 * \brief      A <i>k</i>d-tree over the agent positions (default).
+		 */
+		RVO_KD_TREE,
+
+		/**
+		 * \brief      A uniform grid with the largest neighbor distance of the
+		 *             agents as cell size, hashed into buckets. Cheaper to
+		 *             build and query than the <i>k</i>d-tree when the
+		 *             neighbor distances are uniform and the agent density is
+		 *             bounded.
+		 */
+		RVO_SPATIAL_HASH
+	};
+
+	/**
+	 * \brief      Defines the phases of a simulation step that are timed by
+	 *             the instrumentation of the simulation.
+	 */
+	enum StepPhase {
+		/**
+		 * \brief      Building the agent neighbor index.
+		 */
+		RVO_PHASE_BUILD_AGENT_INDEX,
+
+		/**
+		 * \brief      Computing the agent and obstacle neighbors of the agents.
+		 */
+		RVO_PHASE_COMPUTE_NEIGHBORS,
+
+		/**
+		 * \brief      Constructing the ORCA lines induced by obstacles.
+		 */
+		RVO_PHASE_OBSTACLE_ORCA_LINES,
+
+		/**
+		 * \brief      Constructing the ORCA lines induced by agents.
+		 */
+		RVO_PHASE_AGENT_ORCA_LINES,
+
+		/**
+		 * \brief      Solving the two-dimensional linear programs.
+		 */
+		RVO_PHASE_LINEAR_PROGRAM_2,
+
+		/**
+		 * \brief      Solving the three-dimensional linear programs when the
+		 *             two-dimensional ones are infeasible.
+		 */
+		RVO_PHASE_LINEAR_PROGRAM_3,
+
+		/**
+		 * \brief      Updating the positions and velocities of the agents.
+		 */
+		RVO_PHASE_UPDATE,
+
+		/**
+		 * \brief      The number of phases.
+		 */
+		RVO_NUM_STEP_PHASES
+	};
+
+	/**
+	 * \brief      Defines the timings and counters of a simulation step,
+	 *             collected for each thread when the library is compiled with
+	 *             RVO_INSTRUMENTATION defined as 1.
+	 */
+	class StepStatistics {
+	public:
+		/**
+		 * \brief      Constructs a step statistics instance with zero timings
+		 *             and counters.
+		 */
+		StepStatistics() : numAgentIndexNodeVisits(0), numAgentNeighbors(0), numAgents(0), numLinearProgram3Fallbacks(0), numObstacleNeighbors(0), numObstacleTreeNodeVisits(0)
+		{
+			for (size_t i = 0; i < RVO_NUM_STEP_PHASES; ++i) {
+				phaseTimes[i] = 0.0;
+			}
+		}
+
+		/**
+		 * \brief     The number of agent <i>k</i>d-tree nodes, or spatial hash
+		 *            cells, visited by agent neighbor queries.
+		 */
+		size_t numAgentIndexNodeVisits;
+
+		/**
+		 * \brief     The total number of agent neighbors of the agents.
+		 */
+		size_t numAgentNeighbors;
+
+		/**
+		 * \brief     The number of agents whose new velocity was computed.
+		 */
+		size_t numAgents;
+
+		/**
+		 * \brief     The number of agents whose new velocity needed the
+		 *            three-dimensional linear program.
+		 */
+		size_t numLinearProgram3Fallbacks;
+
+		/**
+		 * \brief     The total number of obstacle neighbors of the agents.
+		 */
+		size_t numObstacleNeighbors;
+
+		/**
+		 * \brief     The number of obstacle <i>k</i>d-tree nodes visited by
+		 *            obstacle neighbor queries.
+		 */
+		size_t numObstacleTreeNodeVisits;
+
+		/**
+		 * \brief     The wall time in seconds spent in each phase, see
+		 *            RVO::StepPhase.
+		 */
+		double phaseTimes[RVO_NUM_STEP_PHASES];
+	};
+
 	class Agent;
+	class AgentNeighborIndex;
 	class KdTree;
+	class NavigationField;
 	class Obstacle;
+	class ObstacleGrid;
+	class SpatialHash;
+	class ThreadPool;
 
 	/**
 	 * \brief      Defines the simulation.
@@ -142,9 +273,31 @@ namespace RVO {
 		 *                             this agent.
 		 * \return     The number of the agent, or RVO::RVO_ERROR when the agent
 		 *             defaults have not been set.
+		 * \note       The number of a removed agent is reused by the next agent
+		 *             that is added.
 		 */
 		size_t addAgent(const Vector2 &position);
 
+		/**
+		 * \brief      Adds a new agent with the parameters of a profile to the
+		 *             simulation.
+		 * \param      position        The two-dimensional starting position of
+		 *                             this agent.
+		 * \param      profileNo       The number of the profile of this agent,
+		 *                             see addProfile().
+		 * \param      radius          The radius of this agent.
+		 *                             Must be non-negative.
+		 * \param      velocity        The initial two-dimensional linear velocity
+		 *                             of this agent (optional).
+		 * \return     The number of the agent, or RVO::RVO_ERROR when the
+		 *             profile is not a shared profile, see addProfile() and
+		 *             getAgentProfile().
+		 * \note       The number of a removed agent is reused by the next agent
+		 *             that is added.
+		 */
+		size_t addAgent(const Vector2 &position, size_t profileNo, float radius,
+						const Vector2 &velocity = Vector2());
+
 		/**
 		 * \brief      Adds a new agent to the simulation.
 		 * \param      position        The two-dimensional starting position of
@@ -185,12 +338,58 @@ namespace RVO {
 		 * \param      velocity        The initial two-dimensional linear velocity
 		 *                             of this agent (optional).
 		 * \return     The number of the agent.
+		 * \note       The number of a removed agent is reused by the next agent
+		 *             that is added.
 		 */
 		size_t addAgent(const Vector2 &position, float neighborDist,
 						size_t maxNeighbors, float timeHorizon,
 						float timeHorizonObst, float radius, float maxSpeed,
 						const Vector2 &velocity = Vector2());
 
+		/**
+		 * \brief      Adds new agents with default properties to the
+		 *             simulation, reserving storage for all of them at once.
+		 * \param      positions       The two-dimensional starting positions of
+		 *                             the agents.
+		 * \return     The numbers of the agents, in the order of their
+		 *             positions, or no numbers when the agent defaults have not
+		 *             been set.
+		 * \note       The numbers of removed agents are reused first.
+		 */
+		std::vector<size_t> addAgents(const std::vector<Vector2> &positions);
+
+		/**
+		 * \brief      Adds a new dynamic obstacle to the simulation. Unlike
+		 *             obstacles added with addObstacle(), dynamic obstacles
+		 *             can be added, moved and removed at any time, at a cost
+		 *             proportional to the number of their edges, and need not
+		 *             be processed.
+		 * \param      vertices        List of the vertices of the polygonal
+		 *             obstacle in counterclockwise order.
+		 * \return     The number of the dynamic obstacle, or RVO::RVO_ERROR
+		 *             when the number of vertices is less than two.
+		 * \note       Dynamic obstacles are numbered separately from the
+		 *             vertices of the static obstacles, and the numbers of
+		 *             removed dynamic obstacles are reused first. Agents avoid
+		 *             dynamic obstacles as they are at the start of each
+		 *             simulation step, like static obstacles.
+		 */
+		size_t addDynamicObstacle(const std::vector<Vector2> &vertices);
+
+		/**
+		 * \brief      Adds a new goal to the navigation grid and builds its goal
+		 *             distance field, which accounts for the obstacles that are
+		 *             present at the time of the call.
+		 * \param      goal            The two-dimensional position of the
+		 *                             goal.
+		 * \return     The number of the goal, or RVO::RVO_ERROR when no
+		 *             navigation grid has been set or the goal is outside of
+		 *             it.
+		 * \note       The static obstacles should have been processed before
+		 *             goals are added.
+		 */
+		size_t addNavigationGoal(const Vector2 &goal);
+
 		/**
 		 * \brief      Adds a new obstacle to the simulation.
 		 * \param      vertices        List of the vertices of the polygonal
@@ -203,6 +402,35 @@ namespace RVO {
 		 */
 		size_t addObstacle(const std::vector<Vector2> &vertices);
 
+		/**
+		 * \brief      Adds a new profile of agent parameters to the simulation.
+		 *             The agents that are added with a profile or are assigned
+		 *             to one share its parameters until one of them is set for
+		 *             the agent alone, and setting a parameter of the profile
+		 *             sets it for all of them at once.
+		 * \param      neighborDist    The maximum distance (center point to
+		 *                             center point) to other agents the agents
+		 *                             take into account in the navigation.
+		 *                             Must be non-negative.
+		 * \param      maxNeighbors    The maximum number of other agents the
+		 *                             agents take into account in the
+		 *                             navigation.
+		 * \param      timeHorizon     The minimal amount of time for which the
+		 *                             velocities of the agents that are computed
+		 *                             by the simulation are safe with respect to
+		 *                             other agents. Must be positive.
+		 * \param      timeHorizonObst The minimal amount of time for which the
+		 *                             velocities of the agents that are computed
+		 *                             by the simulation are safe with respect to
+		 *                             obstacles. Must be positive.
+		 * \param      maxSpeed        The maximum speed of the agents.
+		 *                             Must be non-negative.
+		 * \return     The number of the profile.
+		 */
+		size_t addProfile(float neighborDist, size_t maxNeighbors,
+						  float timeHorizon, float timeHorizonObst,
+						  float maxSpeed);
+
 		/**
 		 * \brief      Lets the simulator perform a simulation step and updates the
 		 *             two-dimensional position and two-dimensional velocity of
@@ -218,6 +446,7 @@ namespace RVO {
 		 * \param      neighborNo      The number of the agent neighbor to be
 		 *                             retrieved.
 		 * \return     The number of the neighboring agent.
+		 * \note       Only available while recording, see setRecording().
 		 */
 		size_t getAgentAgentNeighbor(size_t agentNo, size_t neighborNo) const;
 
@@ -246,6 +475,20 @@ namespace RVO {
 		 */
 		float getAgentNeighborDist(size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the spatial data structure used for agent
+		 *             neighbor queries.
+		 * \return     The present type of the agent neighbor index.
+		 */
+		NeighborIndexType getAgentNeighborIndex() const;
+
+		/**
+		 * \brief      Returns the skin of the agent neighbor lists.
+		 * \return     The present skin, or zero when agent neighbors are
+		 *             queried anew in every simulation step.
+		 */
+		float getAgentNeighborSkin() const;
+
 		/**
 		 * \brief      Returns the count of agent neighbors taken into account to
 		 *             compute the current velocity for the specified agent.
@@ -253,6 +496,7 @@ namespace RVO {
 		 *                             neighbors is to be retrieved.
 		 * \return     The count of agent neighbors taken into account to compute
 		 *             the current velocity for the specified agent.
+		 * \note       Only available while recording, see setRecording().
 		 */
 		size_t getAgentNumAgentNeighbors(size_t agentNo) const;
 
@@ -263,6 +507,7 @@ namespace RVO {
 		 *                             obstacle neighbors is to be retrieved.
 		 * \return     The count of obstacle neighbors taken into account to
 		 *             compute the current velocity for the specified agent.
+		 * \note       Only available while recording, see setRecording().
 		 */
 		size_t getAgentNumObstacleNeighbors(size_t agentNo) const;
 
@@ -274,6 +519,7 @@ namespace RVO {
 		 *                             constraints is to be retrieved.
 		 * \return     The count of ORCA constraints used to compute the current
 		 *             velocity for the specified agent.
+		 * \note       Only available while recording, see setRecording().
 		 */
 		size_t getAgentNumORCALines(size_t agentNo) const;
 
@@ -285,7 +531,9 @@ namespace RVO {
 		 * \param      neighborNo      The number of the obstacle neighbor to be
 		 *                             retrieved.
 		 * \return     The number of the first vertex of the neighboring obstacle
-		 *             edge.
+		 *             edge, or RVO::RVO_ERROR when the edge belongs to a dynamic
+		 *             obstacle.
+		 * \note       Only available while recording, see setRecording().
 		 */
 		size_t getAgentObstacleNeighbor(size_t agentNo, size_t neighborNo) const;
 
@@ -299,7 +547,8 @@ namespace RVO {
 		 * \return     A line representing the specified ORCA constraint.
 		 * \note       The halfplane to the left of the line is the region of
 		 *             permissible velocities with respect to the specified
-		 *             ORCA constraint.
+		 *             ORCA constraint. Only available while recording, see
+		 *             setRecording().
 		 */
 		const Line &getAgentORCALine(size_t agentNo, size_t lineNo) const;
 
@@ -313,6 +562,16 @@ namespace RVO {
 		 */
 		const Vector2 &getAgentPosition(size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the two-dimensional positions of all agents.
+		 * \return     The present two-dimensional positions of the agents,
+		 *             indexed by agent number. Without reordering of the agents,
+		 *             this is the internal storage of the simulator; otherwise
+		 *             the positions are gathered into a buffer. The reference is
+		 *             valid until the simulator is next modified.
+		 */
+		const std::vector<Vector2> &getAgentPositions() const;
+
 		/**
 		 * \brief      Returns the two-dimensional preferred velocity of a
 		 *             specified agent.
@@ -323,6 +582,16 @@ namespace RVO {
 		 */
 		const Vector2 &getAgentPrefVelocity(size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the profile of a specified agent.
+		 * \param      agentNo         The number of the agent whose profile is
+		 *                             to be retrieved.
+		 * \return     The number of the profile of the agent, or RVO::RVO_ERROR
+		 *             when the parameters of the agent have been set for the
+		 *             agent alone.
+		 */
+		size_t getAgentProfile(size_t agentNo) const;
+
 		/**
 		 * \brief      Returns the radius of a specified agent.
 		 * \param      agentNo         The number of the agent whose radius is to
@@ -331,6 +600,20 @@ namespace RVO {
 		 */
 		float getAgentRadius(size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the interval at which the agents are reordered in
+		 *             memory along a space-filling curve.
+		 * \return     The number of simulation steps between reorderings, or
+		 *             zero when the agents are not reordered.
+		 */
+		size_t getAgentReorderInterval() const;
+
+		/**
+		 * \brief      Returns the speed below which agents are put to sleep.
+		 * \return     The present sleep speed, or zero when agents never sleep.
+		 */
+		float getAgentSleepSpeed() const;
+
 		/**
 		 * \brief      Returns the time horizon of a specified agent.
 		 * \param      agentNo         The number of the agent whose time horizon
@@ -350,6 +633,14 @@ namespace RVO {
 		 */
 		float getAgentTimeHorizonObst(size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the threshold up to which the agent
+		 *             <i>k</i>d-tree is refitted instead of rebuilt.
+		 * \return     The present refit threshold of the agent
+		 *             <i>k</i>d-tree (zero if refitting is disabled).
+		 */
+		float getAgentTreeRefitThreshold() const;
+
 		/**
 		 * \brief      Returns the two-dimensional linear velocity of a
 		 *             specified agent.
@@ -360,24 +651,86 @@ namespace RVO {
 		 */
 		const Vector2 &getAgentVelocity(size_t agentNo) const;
 
+		/**
+		 * \brief      Returns the two-dimensional linear velocities of all
+		 *             agents.
+		 * \return     The present two-dimensional linear velocities of the
+		 *             agents, indexed by agent number. Without reordering of the
+		 *             agents, this is the internal storage of the simulator;
+		 *             otherwise the velocities are gathered into a buffer. The
+		 *             reference is valid until the simulator is next modified.
+		 */
+		const std::vector<Vector2> &getAgentVelocities() const;
+
+		/**
+		 * \brief      Returns the cell size of the uniform grid that stores the
+		 *             edges of the dynamic obstacles.
+		 * \return     The present cell size.
+		 */
+		float getDynamicObstacleCellSize() const;
+
 		/**
 		 * \brief      Returns the global time of the simulation.
 		 * \return     The present global time of the simulation (zero initially).
 		 */
 		float getGlobalTime() const;
 
+		/**
+		 * \brief      Returns the direction along the shortest path from a
+		 *             specified point to a specified goal of the navigation
+		 *             grid, in constant time.
+		 * \param      goalNo          The number of the goal.
+		 * \param      point           The two-dimensional point.
+		 * \return     The unit direction towards the goal, or the zero vector
+		 *             when the goal cannot be reached from the point or the
+		 *             point is at the goal.
+		 */
+		Vector2 getNavigationDirection(size_t goalNo, const Vector2 &point) const;
+
+		/**
+		 * \brief      Returns the length of the shortest path from a specified
+		 *             point to a specified goal of the navigation grid, in
+		 *             constant time.
+		 * \param      goalNo          The number of the goal.
+		 * \param      point           The two-dimensional point.
+		 * \return     The length of the path, or the maximum float value when
+		 *             the goal cannot be reached from the point.
+		 */
+		float getNavigationDistance(size_t goalNo, const Vector2 &point) const;
+
 		/**
 		 * \brief      Returns the count of agents in the simulation.
-		 * \return     The count of agents in the simulation.
+		 * \return     The count of agents in the simulation, including inactive
+		 *             agents and the slots of removed agents that have not been
+		 *             reused yet. Agent numbers range from zero to this count.
 		 */
 		size_t getNumAgents() const;
 
+		/**
+		 * \brief      Returns the count of agent velocity computations in which
+		 *             the ORCA constraints were infeasible, so that the
+		 *             three-dimensional linear program was solved to find the
+		 *             velocity that least violates them.
+		 * \return     The count of fallbacks to the three-dimensional linear
+		 *             program since the simulation started.
+		 */
+		size_t getNumLinearProgram3Fallbacks() const;
+
 		/**
 		 * \brief      Returns the count of obstacle vertices in the simulation.
 		 * \return     The count of obstacle vertices in the simulation.
 		 */
 		size_t getNumObstacleVertices() const;
 
+		/**
+		 * \brief      Returns the number of threads of the built-in thread pool
+		 *             of the simulation.
+		 * \return     The number of threads, including the thread calling
+		 *             doStep(), or zero when the built-in thread pool is not
+		 *             used.
+		 */
+		size_t getNumThreads() const;
+
 		/**
 		 * \brief      Returns the two-dimensional position of a specified obstacle
 		 *             vertex.
@@ -408,12 +761,126 @@ namespace RVO {
 		 */
 		size_t getPrevObstacleVertexNo(size_t vertexNo) const;
 
+		/**
+		 * \brief      Returns the maximum neighbor count of a specified profile.
+		 * \param      profileNo       The number of the profile whose maximum
+		 *                             neighbor count is to be retrieved.
+		 * \return     The present maximum neighbor count of the profile.
+		 */
+		size_t getProfileMaxNeighbors(size_t profileNo) const;
+
+		/**
+		 * \brief      Returns the maximum speed of a specified profile.
+		 * \param      profileNo       The number of the profile whose maximum
+		 *                             speed is to be retrieved.
+		 * \return     The present maximum speed of the profile.
+		 */
+		float getProfileMaxSpeed(size_t profileNo) const;
+
+		/**
+		 * \brief      Returns the maximum neighbor distance of a specified
+		 *             profile.
+		 * \param      profileNo       The number of the profile whose maximum
+		 *                             neighbor distance is to be retrieved.
+		 * \return     The present maximum neighbor distance of the profile.
+		 */
+		float getProfileNeighborDist(size_t profileNo) const;
+
+		/**
+		 * \brief      Returns the time horizon of a specified profile.
+		 * \param      profileNo       The number of the profile whose time
+		 *                             horizon is to be retrieved.
+		 * \return     The present time horizon of the profile.
+		 */
+		float getProfileTimeHorizon(size_t profileNo) const;
+
+		/**
+		 * \brief      Returns the time horizon with respect to obstacles of a
+		 *             specified profile.
+		 * \param      profileNo       The number of the profile whose time
+		 *                             horizon with respect to obstacles is to be
+		 *                             retrieved.
+		 * \return     The present time horizon with respect to obstacles of the
+		 *             profile.
+		 */
+		float getProfileTimeHorizonObst(size_t profileNo) const;
+
+		/**
+		 * \brief      Returns a hash of the state of the simulation, for
+		 *             comparing runs of the simulation for bitwise equality.
+		 * \return     A 64-bit FNV-1a hash of the global time and of the
+		 *             activity, position and velocity of each agent, in order
+		 *             of agent number.
+		 */
+		std::uint64_t getStateHash() const;
+
+		/**
+		 * \brief      Returns the timings and counters of the last simulation
+		 *             step for each thread.
+		 * \return     The statistics of the last simulation step, indexed by
+		 *             thread number; thread zero is the thread calling doStep().
+		 *             Empty when the library is compiled without
+		 *             RVO_INSTRUMENTATION.
+		 */
+		const std::vector<StepStatistics> &getStepStatistics() const;
+
 		/**
 		 * \brief      Returns the time step of the simulation.
 		 * \return     The present time step of the simulation.
 		 */
 		float getTimeStep() const;
 
+		/**
+		 * \brief      Returns the timings and counters of the last simulation
+		 *             step summed over all threads.
+		 * \return     The statistics of the last simulation step. The phase
+		 *             times are the sums of the wall times of the threads. All
+		 *             zero when the library is compiled without
+		 *             RVO_INSTRUMENTATION.
+		 */
+		StepStatistics getTotalStepStatistics() const;
+
+		/**
+		 * \brief      Returns whether a specified agent takes part in the
+		 *             simulation.
+		 * \param      agentNo         The number of the agent whose state is to
+		 *                             be retrieved.
+		 * \return     True if the agent is active; false if it has been
+		 *             deactivated or removed.
+		 */
+		bool isAgentActive(size_t agentNo) const;
+
+		/**
+		 * \brief      Returns whether a specified agent is asleep, see
+		 *             setAgentSleepSpeed().
+		 * \param      agentNo         The number of the agent whose state is to
+		 *                             be retrieved.
+		 * \return     True if the agent is asleep.
+		 */
+		bool isAgentSleeping(size_t agentNo) const;
+
+		/**
+		 * \brief      Returns whether the simulation is in deterministic mode.
+		 * \return     True if the simulation is in deterministic mode.
+		 */
+		bool isDeterministic() const;
+
+		/**
+		 * \brief      Returns whether the neighbors and ORCA lines of the agents
+		 *             are recorded, see setRecording().
+		 * \return     True if the neighbors and ORCA lines are recorded.
+		 */
+		bool isRecording() const;
+
+		/**
+		 * \brief      Moves a specified dynamic obstacle.
+		 * \param      obstacleNo      The number of the dynamic obstacle to be
+		 *                             moved.
+		 * \param      displacement    The two-dimensional displacement of all
+		 *                             vertices of the dynamic obstacle.
+		 */
+		void moveDynamicObstacle(size_t obstacleNo, const Vector2 &displacement);
+
 		/**
 		 * \brief      Processes the obstacles that have been added so that they
 		 *             are accounted for in the simulation.
@@ -439,8 +906,72 @@ namespace RVO {
 							 float radius = 0.0f) const;
 
 		/**
-		 * \brief      Sets the default properties for any new agent that is
+		 * \brief      Performs a batch of visibility queries with respect to the
+		 *             obstacles, in parallel over the batch. Consecutive queries
+		 *             traverse the obstacle <i>k</i>d-tree together in packets,
+		 *             so ordering the queries such that consecutive ones are
+		 *             close to each other, e.g. by their first point, makes the
+		 *             batch faster.
+		 * \param      points1         The first points of the queries.
+		 * \param      points2         The second points of the queries, one per
+		 *                             first point.
+		 * \param      radii           The minimal distances between the lines
+		 *                             connecting the points and the obstacles,
+		 *                             one per first point. Must be
+		 *                             non-negative.
+		 * \param      visibility      A reference to the bitmask of the
+		 *                             results, which is resized to one 64-bit
+		 *                             word per 64 queries. Bit i % 64 of word
+		 *                             i / 64 is set if the points of query i
+		 *                             are mutually visible.
+		 * \note       Must not be called while another function of this
+		 *             simulator is using its thread pool.
+		 */
+		void queryVisibility(const std::vector<Vector2> &points1,
+							 const std::vector<Vector2> &points2,
+							 const std::vector<float> &radii,
+							 std::vector<std::uint64_t> &visibility) const;
+
+		/**
+		 * \brief      Removes a specified agent from the simulation. The agent
+		 *             no longer takes part in the simulation and its number is
+		 *             reused by the next agent that is added.
+		 * \param      agentNo         The number of the agent to be removed.
+		 *                             Must not refer to an agent that has
+		 *                             already been removed.
+		 */
+		void removeAgent(size_t agentNo);
+
+		/**
+		 * \brief      Removes a specified dynamic obstacle from the simulation.
+		 *             Its number is reused by the next dynamic obstacle that is
 		 *             added.
+		 * \param      obstacleNo      The number of the dynamic obstacle to be
+		 *                             removed.
+		 */
+		void removeDynamicObstacle(size_t obstacleNo);
+
+		/**
+		 * \brief      Activates or deactivates a specified agent. Inactive agents
+		 *             are neither moved nor taken into account by other agents,
+		 *             but keep their state and number.
+		 * \param      agentNo         The number of the agent whose state is to
+		 *                             be modified. Must not refer to a removed
+		 *                             agent.
+		 * \param      active          True if the agent is to take part in the
+		 *                             simulation.
+		 */
+		void setAgentActive(size_t agentNo, bool active);
+
+		/**
+		 * \brief      Sets the default properties for any new agent that is
+		 *             added. The parameters other than the radius and the
+		 *             velocity become a new profile shared by the agents that
+		 *             are added with default properties, see getAgentProfile().
+		 *             Each call adds a profile, and the profiles of earlier
+		 *             defaults keep their numbers and parameters, so a
+		 *             simulation that changes the defaults often should add
+		 *             agents with profiles of addProfile() instead.
 		 * \param      neighborDist    The default maximum distance (center point
 		 *                             to center point) to other agents a new agent
 		 *                             takes into account in the navigation. The
@@ -508,6 +1039,34 @@ namespace RVO {
 		 */
 		void setAgentNeighborDist(size_t agentNo, float neighborDist);
 
+		/**
+		 * \brief      Sets the spatial data structure used for agent neighbor
+		 *             queries.
+		 * \param      type            The type of the agent neighbor index.
+		 */
+		void setAgentNeighborIndex(NeighborIndexType type);
+
+		/**
+		 * \brief      Sets the skin of the agent neighbor lists. With a positive
+		 *             skin, each agent keeps a list of the agents within its
+		 *             neighbor distance plus the skin, and selects its nearest
+		 *             agent neighbors from that list. The lists are rebuilt
+		 *             from the agent neighbor index only once an agent has
+		 *             moved more than half the skin since the last rebuild, or
+		 *             when agents are added, removed, activated or deactivated,
+		 *             so the agents find neighbors at the same distances as
+		 *             without lists. Agent neighbors at equal distance may come
+		 *             in another order than from the agent neighbor index, so
+		 *             the trajectories are identical to those without lists
+		 *             only in deterministic mode, see setDeterministic().
+		 * \param      skin            The skin, which must be non-negative.
+		 *                             Zero (the default) disables the lists. A
+		 *                             skin of a few times the distance that the
+		 *                             agents move per simulation step suits
+		 *                             dense and slow crowds.
+		 */
+		void setAgentNeighborSkin(float skin);
+
 		/**
 		 * \brief      Sets the two-dimensional position of a specified agent.
 		 * \param      agentNo         The number of the agent whose
@@ -528,6 +1087,43 @@ namespace RVO {
 		 */
 		void setAgentPrefVelocity(size_t agentNo, const Vector2 &prefVelocity);
 
+		/**
+		 * \brief      Sets the two-dimensional preferred velocities of all
+		 *             agents.
+		 * \param      prefVelocities  The replacement two-dimensional preferred
+		 *                             velocities, indexed by agent number. Must
+		 *                             contain exactly one velocity per agent,
+		 *                             see getNumAgents(); otherwise no
+		 *                             preferred velocity is changed.
+		 */
+		void setAgentPrefVelocities(const std::vector<Vector2> &prefVelocities);
+
+		/**
+		 * \brief      Sets the two-dimensional preferred velocities of all
+		 *             agents towards their goals of the navigation grid, at
+		 *             their maximum speeds but slowing down so as not to
+		 *             overshoot their goals within a time step.
+		 * \param      goalNos         The numbers of the goals of the agents,
+		 *                             indexed by agent number. Must contain one
+		 *                             goal per agent, see getNumAgents().
+		 *                             Agents with goal RVO::RVO_ERROR, and
+		 *                             inactive agents, keep their preferred
+		 *                             velocities.
+		 */
+		void setAgentPrefVelocitiesToGoals(const std::vector<size_t> &goalNos);
+
+		/**
+		 * \brief      Sets the profile of a specified agent, replacing the
+		 *             parameters that have been set for the agent alone.
+		 * \param      agentNo         The number of the agent whose profile is
+		 *                             to be modified.
+		 * \param      profileNo       The number of the replacement profile.
+		 *                             Must be a shared profile, see
+		 *                             addProfile() and getAgentProfile();
+		 *                             otherwise the agent keeps its profile.
+		 */
+		void setAgentProfile(size_t agentNo, size_t profileNo);
+
 		/**
 		 * \brief      Sets the radius of a specified agent.
 		 * \param      agentNo         The number of the agent whose radius is to
@@ -537,6 +1133,38 @@ namespace RVO {
 		 */
 		void setAgentRadius(size_t agentNo, float radius);
 
+		/**
+		 * \brief      Sets the interval at which the agents are reordered in
+		 *             memory along a Morton (Z-order) curve through their
+		 *             positions, so that agents that are close in space are
+		 *             processed together and share cache lines. Agent numbers
+		 *             are not affected by the reordering.
+		 * \param      numSteps        The number of simulation steps between
+		 *                             reorderings, starting with the next step.
+		 *                             Zero (the default) disables reordering.
+		 */
+		void setAgentReorderInterval(size_t numSteps);
+
+		/**
+		 * \brief      Sets the speed below which agents are put to sleep. An
+		 *             agent falls asleep after a simulation step in which its
+		 *             preferred velocity and its new velocity are below the
+		 *             sleep speed and none of its awake agent neighbors moves
+		 *             toward it faster than the sleep speed. A sleeping agent
+		 *             keeps its position with zero velocity and computes
+		 *             neither neighbors nor a new velocity, and other agents
+		 *             avoid it as a stationary agent. It wakes up at the next
+		 *             simulation step once its preferred velocity exceeds the
+		 *             sleep speed, its position or velocity is set, or an agent
+		 *             moving faster than the sleep speed approaches it within
+		 *             its neighbor distance. Dynamic obstacles do not wake up
+		 *             sleeping agents.
+		 * \param      speed           The sleep speed, which must be
+		 *                             non-negative. Zero (the default) keeps
+		 *                             all agents awake.
+		 */
+		void setAgentSleepSpeed(float speed);
+
 		/**
 		 * \brief      Sets the time horizon of a specified agent with respect
 		 *             to other agents.
@@ -557,6 +1185,22 @@ namespace RVO {
 		 */
 		void setAgentTimeHorizonObst(size_t agentNo, float timeHorizonObst);
 
+		/**
+		 * \brief      Sets the threshold up to which the agent
+		 *             <i>k</i>d-tree is refitted instead of rebuilt in each
+		 *             simulation step. A refit keeps the partition of the agents
+		 *             and only updates the bounding boxes of the tree nodes; the
+		 *             tree is rebuilt once its cost (the summed half-perimeters
+		 *             of the node bounding boxes relative to that of the root)
+		 *             exceeds the cost after the last rebuild by more than the
+		 *             threshold, or when agents are added or removed.
+		 * \param      threshold       The tolerated relative increase of the
+		 *                             cost of the tree, e.g. 0.25 for 25
+		 *                             percent. Zero (the default) disables
+		 *                             refitting. Must be non-negative.
+		 */
+		void setAgentTreeRefitThreshold(float threshold);
+
 		/**
 		 * \brief      Sets the two-dimensional linear velocity of a specified
 		 *             agent.
@@ -568,6 +1212,129 @@ namespace RVO {
 		 */
 		void setAgentVelocity(size_t agentNo, const Vector2 &velocity);
 
+		/**
+		 * \brief      Sets the number of threads of the built-in thread pool of
+		 *             the simulation. The threads persist between simulation
+		 *             steps and balance the agents among themselves by stealing
+		 *             chunks of consecutive agents from each other.
+		 * \param      numThreads      The number of threads, including the
+		 *                             thread calling doStep(). Zero (the
+		 *                             default) disables the built-in thread
+		 *                             pool, so that the agents are processed
+		 *                             with OpenMP when it is enabled, and
+		 *                             sequentially otherwise.
+		 */
+		void setNumThreads(size_t numThreads);
+
+		/**
+		 * \brief      Sets whether the simulation is in deterministic mode.
+		 *             The agents are always processed independently of each
+		 *             other, so the result of a simulation step does not depend
+		 *             on the number of threads or on their scheduling. In
+		 *             deterministic mode, agent neighbors at equal distance are
+		 *             in addition ordered by agent number, so that the result
+		 *             neither depends on the order in which the agent neighbor
+		 *             index visits them, and thereby on the agent neighbor
+		 *             index type, on the order of the agents in memory, or on
+		 *             whether the agent <i>k</i>d-tree was refitted or rebuilt.
+		 * \param      deterministic   True to enable deterministic mode (off by
+		 *                             default).
+		 * \note       Bitwise equality across machines additionally requires
+		 *             that the library is compiled for the same floating-point
+		 *             instruction set without contraction of floating-point
+		 *             expressions, e.g. into fused multiply-adds.
+		 */
+		void setDeterministic(bool deterministic);
+
+		/**
+		 * \brief      Sets the cell size of the uniform grid that stores the
+		 *             edges of the dynamic obstacles.
+		 * \param      cellSize        The cell size, which must be positive.
+		 *                             Cells of about the obstacle neighbor
+		 *                             range of the agents work well; the
+		 *                             default is 10.
+		 */
+		void setDynamicObstacleCellSize(float cellSize);
+
+		/**
+		 * \brief      Sets the uniform grid on which goal distance fields for
+		 *             global navigation are built, and removes all goals of the
+		 *             previous grid.
+		 * \param      minCorner       The minimum corner of the grid.
+		 * \param      maxCorner       The maximum corner of the grid.
+		 * \param      cellSize        The cell size, which must be positive.
+		 *                             Memory and build time grow with the
+		 *                             number of cells; lookups take constant
+		 *                             time regardless.
+		 * \param      radius          The minimal distance between the paths
+		 *                             and the obstacles, typically the largest
+		 *                             agent radius. Must be non-negative.
+		 */
+		void setNavigationGrid(const Vector2 &minCorner, const Vector2 &maxCorner,
+							   float cellSize, float radius);
+
+		/**
+		 * \brief      Sets the maximum neighbor count of a specified profile.
+		 * \param      profileNo       The number of the profile whose maximum
+		 *                             neighbor count is to be modified.
+		 * \param      maxNeighbors    The replacement maximum neighbor count.
+		 */
+		void setProfileMaxNeighbors(size_t profileNo, size_t maxNeighbors);
+
+		/**
+		 * \brief      Sets the maximum speed of a specified profile.
+		 * \param      profileNo       The number of the profile whose maximum
+		 *                             speed is to be modified.
+		 * \param      maxSpeed        The replacement maximum speed. Must be
+		 *                             non-negative.
+		 */
+		void setProfileMaxSpeed(size_t profileNo, float maxSpeed);
+
+		/**
+		 * \brief      Sets the maximum neighbor distance of a specified
+		 *             profile.
+		 * \param      profileNo       The number of the profile whose maximum
+		 *                             neighbor distance is to be modified.
+		 * \param      neighborDist    The replacement maximum neighbor distance.
+		 *                             Must be non-negative.
+		 */
+		void setProfileNeighborDist(size_t profileNo, float neighborDist);
+
+		/**
+		 * \brief      Sets the time horizon of a specified profile with respect
+		 *             to other agents.
+		 * \param      profileNo       The number of the profile whose time
+		 *                             horizon is to be modified.
+		 * \param      timeHorizon     The replacement time horizon with respect
+		 *                             to other agents. Must be positive.
+		 */
+		void setProfileTimeHorizon(size_t profileNo, float timeHorizon);
+
+		/**
+		 * \brief      Sets the time horizon of a specified profile with respect
+		 *             to obstacles.
+		 * \param      profileNo       The number of the profile whose time
+		 *                             horizon with respect to obstacles is to be
+		 *                             modified.
+		 * \param      timeHorizonObst The replacement time horizon with respect to
+		 *                             obstacles. Must be positive.
+		 */
+		void setProfileTimeHorizonObst(size_t profileNo, float timeHorizonObst);
+
+		/**
+		 * \brief      Sets whether the agent neighbors, obstacle neighbors and
+		 *             ORCA lines of each agent are recorded for
+		 *             getAgentAgentNeighbor(), getAgentObstacleNeighbor(),
+		 *             getAgentORCALine() and their counts. Without recording,
+		 *             the agents computed on the same thread share one set of
+		 *             buffers during doStep(), which keeps them out of the
+		 *             memory of the agents.
+		 * \param      recording       True to record the neighbors and ORCA
+		 *                             lines (off by default). They are
+		 *                             available from the next simulation step.
+		 */
+		void setRecording(bool recording);
+
 		/**
 		 * \brief      Sets the time step of the simulation.
 		 * \param      timeStep        The time step of the simulation.
@@ -576,16 +1343,257 @@ namespace RVO {
 		void setTimeStep(float timeStep);
 
 	private:
+		class VisibilityTask;
+
+		/**
+		 * \brief      Defines a profile of agent parameters, shared by the
+		 *             agents that refer to it, or owned by an agent whose
+		 *             parameters have been set for the agent alone.
+		 */
+		class AgentProfile {
+		public:
+			/**
+			 * \brief      True if the profile has been freed for reuse.
+			 */
+			bool isFree;
+
+			/**
+			 * \brief      True if the profile is owned by a single agent.
+			 */
+			bool isOwned;
+
+			/**
+			 * \brief      The maximum neighbor count.
+			 */
+			size_t maxNeighbors;
+
+			/**
+			 * \brief      The maximum speed.
+			 */
+			float maxSpeed;
+
+			/**
+			 * \brief      The maximum neighbor distance.
+			 */
+			float neighborDist;
+
+			/**
+			 * \brief      The time horizon with respect to other agents.
+			 */
+			float timeHorizon;
+
+			/**
+			 * \brief      The time horizon with respect to obstacles.
+			 */
+			float timeHorizonObst;
+		};
+
+		/**
+		 * \brief      Defines the buffers that an agent uses while its
+		 *             neighbors and new velocity are computed, shared by the
+		 *             agents computed on the same thread unless recording.
+		 */
+		class AgentScratch {
+		public:
+			/**
+			 * \brief      The agent neighbors.
+			 */
+			std::vector<std::pair<float, size_t> > agentNeighbors;
+
+			/**
+			 * \brief      The obstacle neighbors.
+			 */
+			std::vector<std::pair<float, const Obstacle *> > obstacleNeighbors;
+
+			/**
+			 * \brief      The ORCA lines.
+			 */
+			std::vector<Line> orcaLines;
+
+			/**
+			 * \brief      The projected lines of the three-dimensional linear
+			 *             program.
+			 */
+			std::vector<Line> projLines;
+		};
+
+		/**
+		 * \brief      Computes the neighbors and new velocities of a range of
+		 *             agents.
+		 * \param      begin           The index of the first agent.
+		 * \param      end             One past the index of the last agent.
+		 */
+		void computeNewVelocities(size_t begin, size_t end);
+
+		/**
+		 * \brief      Returns the number of threads that process the agents.
+		 * \return     The number of threads of the thread pool, or of OpenMP
+		 *             when the thread pool is disabled.
+		 */
+		size_t getNumWorkerThreads() const;
+
+		/**
+		 * \brief      Returns the profile owned by an agent, which starts as a
+		 *             copy of its shared profile.
+		 * \param      agentIndex      The index of the agent.
+		 * \return     A reference to the profile owned by the agent.
+		 */
+		AgentProfile &getOwnedProfile(size_t agentIndex);
+
+		/**
+		 * \brief      Returns the number of the calling thread among the threads
+		 *             that process the agents.
+		 * \return     The number of the calling thread; zero for the thread
+		 *             calling doStep().
+		 */
+		size_t getThreadNo() const;
+
+		/**
+		 * \brief      Returns whether the agents keep their agent neighbors
+		 *             between simulation steps, which recording, the agent
+		 *             neighbor lists and sleeping agents require.
+		 * \return     True if the agents keep their agent neighbors.
+		 */
+		bool isKeepingAgentNeighbors() const;
+
+		/**
+		 * \brief      Returns whether a profile exists and is shared, so that
+		 *             agents may refer to it.
+		 * \param      profileNo       The number of the profile.
+		 * \return     True if the profile is neither owned by an agent nor
+		 *             freed.
+		 */
+		bool isSharedProfile(size_t profileNo) const;
+
+		/**
+		 * \brief      Answers the visibility queries of a range of bitmask words
+		 *             of a batch.
+		 * \param      points1         The first points of the queries.
+		 * \param      points2         The second points of the queries.
+		 * \param      radii           The radii of the queries.
+		 * \param      numQueries      The number of queries of the batch.
+		 * \param      begin           The first bitmask word.
+		 * \param      end             One past the last bitmask word.
+		 * \param      visibility      The bitmask of the results.
+		 */
+		void queryVisibilityWords(const Vector2 *points1, const Vector2 *points2,
+								  const float *radii, size_t numQueries,
+								  size_t begin, size_t end,
+								  std::uint64_t *visibility) const;
+
+		/**
+		 * \brief      Frees the buffers of the agents that are not kept between
+		 *             simulation steps.
+		 */
+		void releaseAgentBuffers();
+
+		/**
+		 * \brief      Frees the profile owned by an agent, if any, for reuse.
+		 * \param      agentIndex      The index of the agent.
+		 */
+		void releaseOwnedProfile(size_t agentIndex);
+
+		/**
+		 * \brief      Reorders the agents in memory by the Morton code of their
+		 *             positions.
+		 */
+		void reorderAgents();
+
+		/**
+		 * \brief      Stores a profile, reusing the slot of a freed profile if
+		 *             there is one.
+		 * \param      profile         The profile.
+		 * \return     The number of the profile.
+		 */
+		size_t storeProfile(const AgentProfile &profile);
+
+		/**
+		 * \brief      Exchanges the buffers of an agent with the scratch
+		 *             buffers of a thread.
+		 * \param      agent           The agent.
+		 * \param      scratch         The scratch buffers.
+		 * \param      agentNeighbors  True to exchange the agent neighbors too.
+		 */
+		void swapAgentBuffers(Agent *agent, AgentScratch &scratch,
+							  bool agentNeighbors);
+
+		/**
+		 * \brief      Updates the positions and velocities of a range of agents.
+		 * \param      begin           The index of the first agent.
+		 * \param      end             One past the index of the last agent.
+		 */
+		void updateAgents(size_t begin, size_t end);
+
+		/**
+		 * \brief      Wakes up the sleeping agents that moving agents approach
+		 *             and puts to sleep the agents that have come to rest.
+		 */
+		void updateSleepingAgents();
+
+		/**
+		 * \brief      Wakes up an agent if it is asleep.
+		 * \param      agentIndex      The index of the agent.
+		 */
+		void wakeAgent(size_t agentIndex);
+
+		/*
+		 * Per-agent state that is read for every neighbor in every step is kept
+		 * in contiguous arrays indexed by agent index (structure of arrays);
+		 * the remaining per-agent state is kept in agents_. The agent index
+		 * changes when the agents are reordered, the agent number used in the
+		 * public interface does not; agentIndices_ and agentNumbers_ map
+		 * between the two. The parameters of the agents are kept in
+		 * agentProfiles_, which the agents refer to by profile number.
+		 */
+		std::vector<char> agentActive_;
+		std::vector<size_t> agentIndices_;
+		AgentNeighborIndex *agentNeighborIndex_;
+		float agentNeighborSkin_;
+		std::vector<size_t> agentNumbers_;
+		mutable std::vector<Vector2> agentPositionBuffer_;
+		std::vector<Vector2> agentPositions_;
+		std::vector<Vector2> agentPrefVelocities_;
+		std::vector<AgentProfile> agentProfiles_;
+		std::vector<float> agentRadii_;
+		size_t agentReorderInterval_;
+		std::vector<AgentScratch> agentScratch_;
+		std::vector<char> agentSleeping_;
+		float agentSleepSpeed_;
+		bool agentsReordered_;
+		mutable std::vector<Vector2> agentVelocityBuffer_;
+		std::vector<Vector2> agentVelocities_;
 		std::vector<Agent *> agents_;
-		Agent *defaultAgent_;
+		size_t defaultProfileNo_;
+		float defaultRadius_;
+		Vector2 defaultVelocity_;
+		bool deterministic_;
+		std::vector<size_t> freeAgents_;
+		std::vector<size_t> freeProfiles_;
 		float globalTime_;
+		bool hasInvalidNeighborLists_;
 		KdTree *kdTree_;
+		NavigationField *navigationField_;
+		std::vector<Vector2> neighborListPositions_;
+		size_t numStepsSinceAgentReorder_;
+		ObstacleGrid *obstacleGrid_;
 		std::vector<Obstacle *> obstacles_;
+		bool rebuildNeighborLists_;
+		bool recording_;
+		SpatialHash *spatialHash_;
+		std::vector<StepStatistics> stepStatistics_;
+		ThreadPool *threadPool_;
 		float timeStep_;
 
+		static const size_t AGENT_CHUNK_SIZE = 64;
+		static const size_t VISIBILITY_CHUNK_SIZE = 4;
+
 		friend class Agent;
+		friend class ApproachingAgents;
 		friend class KdTree;
+		friend class NavigationField;
 		friend class Obstacle;
+		friend class ObstacleGrid;
+		friend class SpatialHash;
 	};
 }
 
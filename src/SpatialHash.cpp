@@ -0,0 +1,196 @@
+/*
+ * SpatialHash.cpp
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#include "SpatialHash.h"
+
+#include "Agent.h"
+#include "ApproachingAgents.h"
+#include "RVOSimulator.h"
+
+namespace RVO {
+	SpatialHash::SpatialHash(RVOSimulator *sim) : cellSize_(1.0f), invCellSize_(1.0f), sim_(sim) { }
+
+	void SpatialHash::buildAgentIndex()
+	{
+		const size_t numSlots = sim_->agents_.size();
+		size_t numAgents = 0;
+
+		cellSize_ = 0.0f;
+
+		for (size_t i = 0; i < numSlots; ++i) {
+			if (sim_->agentActive_[i]) {
+				cellSize_ = std::max(cellSize_, sim_->agentProfiles_[sim_->agents_[i]->profileNo_].neighborDist);
+				++numAgents;
+			}
+		}
+
+		if (cellSize_ <= RVO_EPSILON) {
+			cellSize_ = 1.0f;
+		}
+
+		invCellSize_ = 1.0f / cellSize_;
+
+		size_t numBuckets = 1;
+
+		while (numBuckets < 2 * numAgents) {
+			numBuckets *= 2;
+		}
+
+		/* Counting sort of the agents by bucket. */
+		bucketBegin_.assign(numBuckets + 1, 0);
+		agentBuckets_.resize(numSlots);
+
+		for (size_t i = 0; i < numSlots; ++i) {
+			if (sim_->agentActive_[i]) {
+				const Vector2 &position = sim_->agentPositions_[i];
+
+				agentBuckets_[i] = getBucket(getCell(position.x()), getCell(position.y()));
+				++bucketBegin_[agentBuckets_[i] + 1];
+			}
+		}
+
+		for (size_t i = 0; i < numBuckets; ++i) {
+			bucketBegin_[i + 1] += bucketBegin_[i];
+		}
+
+		agents_.resize(numAgents);
+		cellX_.resize(numAgents);
+		cellY_.resize(numAgents);
+
+		for (size_t i = 0; i < numSlots; ++i) {
+			if (sim_->agentActive_[i]) {
+				const Vector2 &position = sim_->agentPositions_[i];
+				const size_t j = bucketBegin_[agentBuckets_[i]]++;
+
+				agents_[j] = i;
+				cellX_[j] = getCell(position.x());
+				cellY_[j] = getCell(position.y());
+			}
+		}
+
+		/* Each bucket now begins where the previous one began before. */
+		for (size_t i = numBuckets; i > 0; --i) {
+			bucketBegin_[i] = bucketBegin_[i - 1];
+		}
+
+		bucketBegin_[0] = 0;
+	}
+
+	void SpatialHash::computeAgentNeighbors(Agent *agent, float &rangeSq) const
+	{
+		if (!agents_.empty()) {
+			queryAgentNeighbors(agent, *agent, rangeSq);
+		}
+	}
+
+	void SpatialHash::computeApproachingAgents(Agent *agent, ApproachingAgents &agents, float rangeSq) const
+	{
+		if (!agents_.empty()) {
+			queryAgentNeighbors(agent, agents, rangeSq);
+		}
+	}
+
+#if RVO_FIXED_MAX_NEIGHBORS
+	void SpatialHash::computeFixedAgentNeighbors(Agent *agent, FixedAgentNeighbors<RVO_FIXED_MAX_NEIGHBORS> &neighbors, float &rangeSq) const
+	{
+		if (!agents_.empty()) {
+			queryAgentNeighbors(agent, neighbors, rangeSq);
+		}
+	}
+#endif
+
+	size_t SpatialHash::getBucket(int cellX, int cellY) const
+	{
+		/* The number of buckets is a power of two; mask with one less. */
+		const size_t bucketMask = bucketBegin_.size() - 2;
+
+		return static_cast<size_t>((static_cast<unsigned int>(cellX) * 73856093u) ^ (static_cast<unsigned int>(cellY) * 19349663u)) & bucketMask;
+	}
+
+	int SpatialHash::getCell(float coordinate) const
+	{
+		return static_cast<int>(std::floor(coordinate * invCellSize_));
+	}
+
+	template <class AgentNeighbors>
+	void SpatialHash::queryAgentNeighbors(Agent *agent, AgentNeighbors &neighbors, float &rangeSq) const
+	{
+		const Vector2 &position = sim_->agentPositions_[agent->id_];
+		const int cellX = getCell(position.x());
+		const int cellY = getCell(position.y());
+
+#if RVO_INSTRUMENTATION
+		++agent->statistics_->numAgentIndexNodeVisits;
+#endif
+
+		/* Query the cell of the agent first, so that the range shrinks early. */
+		queryCell(neighbors, rangeSq, cellX, cellY);
+
+		const float range = std::sqrt(rangeSq);
+		const int minCellX = getCell(position.x() - range);
+		const int maxCellX = getCell(position.x() + range);
+		const int minCellY = getCell(position.y() - range);
+		const int maxCellY = getCell(position.y() + range);
+
+		for (int y = minCellY; y <= maxCellY; ++y) {
+			const float distSqY = sqr(std::max(0.0f, std::max(y * cellSize_ - position.y(), position.y() - (y + 1) * cellSize_)));
+
+			for (int x = minCellX; x <= maxCellX; ++x) {
+				if (x == cellX && y == cellY) {
+					continue;
+				}
+
+				const float distSqX = sqr(std::max(0.0f, std::max(x * cellSize_ - position.x(), position.x() - (x + 1) * cellSize_)));
+
+				if (distSqX + distSqY < rangeSq || (sim_->deterministic_ && distSqX + distSqY == rangeSq)) {
+#if RVO_INSTRUMENTATION
+					++agent->statistics_->numAgentIndexNodeVisits;
+#endif
+					queryCell(neighbors, rangeSq, x, y);
+				}
+			}
+		}
+	}
+
+	template <class AgentNeighbors>
+	void SpatialHash::queryCell(AgentNeighbors &neighbors, float &rangeSq, int cellX, int cellY) const
+	{
+		const size_t bucket = getBucket(cellX, cellY);
+
+		for (size_t i = bucketBegin_[bucket]; i < bucketBegin_[bucket + 1]; ++i) {
+			/* Skip agents of other cells that share the bucket. */
+			if (cellX_[i] == cellX && cellY_[i] == cellY) {
+				neighbors.insertAgentNeighbor(agents_[i], rangeSq);
+			}
+		}
+	}
+}
@@ -0,0 +1,150 @@
+/*
+ * SpatialHash.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#ifndef RVO_SPATIAL_HASH_H_
+#define RVO_SPATIAL_HASH_H_
+
+/**
+ * \file       SpatialHash.h
+ * \brief      Contains the SpatialHash class.
+ */
+
+#include "AgentNeighborIndex.h"
+
+namespace RVO {
+	/**
+	 * \brief      Defines a uniform-grid spatial hash for agent neighbor
+	 *             queries in the simulation.
+	 *
+	 * The cell size equals the largest neighbor distance of the active agents,
+	 * so a query visits at most three by three cells. The grid cells are hashed
+	 * into a table of buckets, and the agents are sorted by bucket using a
+	 * counting sort in linear time.
+	 */
+	class SpatialHash : public AgentNeighborIndex {
+	private:
+		/**
+		 * \brief      Constructs a spatial hash instance.
+		 * \param      sim             The simulator instance.
+		 */
+		explicit SpatialHash(RVOSimulator *sim);
+
+		/**
+		 * \brief      Builds the spatial hash.
+		 */
+		virtual void buildAgentIndex();
+
+		/**
+		 * \brief      Computes the agent neighbors of the specified agent.
+		 * \param      agent           A pointer to the agent for which agent
+		 *                             neighbors are to be computed.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		virtual void computeAgentNeighbors(Agent *agent, float &rangeSq) const;
+
+		/**
+		 * \brief      Tests whether an awake agent moving faster than the sleep
+		 *             speed approaches the specified sleeping agent.
+		 * \param      agent           A pointer to the sleeping agent.
+		 * \param      agents          The test of the approaching agents.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		virtual void computeApproachingAgents(Agent *agent,
+											  ApproachingAgents &agents,
+											  float rangeSq) const;
+
+#if RVO_FIXED_MAX_NEIGHBORS
+		/**
+		 * \brief      Computes the agent neighbors of the specified agent into
+		 *             a set with a maximum number of agent neighbors fixed at
+		 *             compile time.
+		 * \param      agent           A pointer to the agent for which agent
+		 *                             neighbors are to be computed.
+		 * \param      neighbors       The set of agent neighbors.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		virtual void computeFixedAgentNeighbors(Agent *agent,
+												FixedAgentNeighbors<RVO_FIXED_MAX_NEIGHBORS> &neighbors,
+												float &rangeSq) const;
+
+#endif
+		/**
+		 * \brief      Returns the bucket of the specified grid cell.
+		 * \param      cellX           The x-coordinate of the grid cell.
+		 * \param      cellY           The y-coordinate of the grid cell.
+		 * \return     The number of the bucket of the grid cell.
+		 */
+		size_t getBucket(int cellX, int cellY) const;
+
+		/**
+		 * \brief      Returns the grid cell coordinate of the specified
+		 *             coordinate.
+		 * \param      coordinate      The x- or y-coordinate of a point.
+		 * \return     The corresponding x- or y-coordinate of the grid cell.
+		 */
+		int getCell(float coordinate) const;
+
+		/**
+		 * \brief      Queries the cell of the agent and the cells within range
+		 *             of it for the agent neighbors of the specified agent.
+		 * \param      agent           A pointer to the agent for which agent
+		 *                             neighbors are to be computed.
+		 * \param      neighbors       The set into which the agent neighbors
+		 *                             are inserted, the agent itself, a set
+		 *                             with a fixed maximum number of agent
+		 *                             neighbors, or a test of approaching
+		 *                             agents.
+		 * \param      rangeSq         The squared range around the agent.
+		 */
+		template <class AgentNeighbors>
+		void queryAgentNeighbors(Agent *agent, AgentNeighbors &neighbors,
+								 float &rangeSq) const;
+
+		template <class AgentNeighbors>
+		void queryCell(AgentNeighbors &neighbors, float &rangeSq, int cellX,
+					   int cellY) const;
+
+		std::vector<size_t> agentBuckets_;
+		std::vector<size_t> agents_;
+		std::vector<size_t> bucketBegin_;
+		std::vector<int> cellX_;
+		std::vector<int> cellY_;
+		float cellSize_;
+		float invCellSize_;
+		RVOSimulator *sim_;
+
+		friend class Agent;
+		friend class RVOSimulator;
+	};
+}
+
+#endif /* RVO_SPATIAL_HASH_H_ */
@@ -0,0 +1,200 @@
+/*
+ * ThreadPool.cpp
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#include "ThreadPool.h"
+
+namespace RVO {
+	namespace {
+		/* The number of the thread within its thread pool. */
+		thread_local size_t threadNo = 0;
+	}
+
+	ThreadPool::ThreadPool(size_t numThreads) : chunkSize_(1), generation_(0), numBusyThreads_(0), numItems_(0), stop_(false), task_(NULL)
+	{
+		for (size_t i = 0; i < numThreads; ++i) {
+			workers_.push_back(new Worker());
+			workers_[i]->begin = 0;
+			workers_[i]->end = 0;
+		}
+
+		/* The calling thread is worker zero. */
+		for (size_t i = 1; i < numThreads; ++i) {
+			threads_.push_back(std::thread(&ThreadPool::threadMain, this, i));
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+
+		startCondition_.notify_all();
+
+		for (size_t i = 0; i < threads_.size(); ++i) {
+			threads_[i].join();
+		}
+
+		for (size_t i = 0; i < workers_.size(); ++i) {
+			delete workers_[i];
+		}
+	}
+
+	size_t ThreadPool::getNumThreads() const
+	{
+		return workers_.size();
+	}
+
+	size_t ThreadPool::getThreadNo()
+	{
+		return threadNo;
+	}
+
+	void ThreadPool::parallelFor(size_t numItems, size_t chunkSize, Task &task)
+	{
+		if (numItems == 0) {
+			return;
+		}
+
+		const size_t numChunks = (numItems + chunkSize - 1) / chunkSize;
+
+		if (threads_.empty() || numChunks == 1) {
+			task.run(0, numItems);
+			return;
+		}
+
+		/* Give each thread a contiguous range of chunks. */
+		for (size_t i = 0; i < workers_.size(); ++i) {
+			std::lock_guard<std::mutex> lock(workers_[i]->mutex);
+			workers_[i]->begin = i * numChunks / workers_.size();
+			workers_[i]->end = (i + 1) * numChunks / workers_.size();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			chunkSize_ = chunkSize;
+			numItems_ = numItems;
+			task_ = &task;
+			numBusyThreads_ = threads_.size();
+			++generation_;
+		}
+
+		startCondition_.notify_all();
+
+		runChunks(0);
+
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		while (numBusyThreads_ != 0) {
+			doneCondition_.wait(lock);
+		}
+
+		task_ = NULL;
+	}
+
+	bool ThreadPool::popChunk(size_t workerNo, size_t &chunk)
+	{
+		Worker *const worker = workers_[workerNo];
+		std::lock_guard<std::mutex> lock(worker->mutex);
+
+		if (worker->begin == worker->end) {
+			return false;
+		}
+
+		chunk = worker->begin++;
+
+		return true;
+	}
+
+	void ThreadPool::runChunks(size_t workerNo)
+	{
+		size_t chunk;
+
+		while (popChunk(workerNo, chunk) || stealChunk(workerNo, chunk)) {
+			const size_t begin = chunk * chunkSize_;
+			task_->run(begin, std::min(begin + chunkSize_, numItems_));
+		}
+	}
+
+	bool ThreadPool::stealChunk(size_t workerNo, size_t &chunk)
+	{
+		/*
+		 * Steal from the end of the other ranges, away from the chunks their
+		 * owners are working on.
+		 */
+		for (size_t i = 1; i < workers_.size(); ++i) {
+			Worker *const victim = workers_[(workerNo + i) % workers_.size()];
+			std::lock_guard<std::mutex> lock(victim->mutex);
+
+			if (victim->begin != victim->end) {
+				chunk = --victim->end;
+
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void ThreadPool::threadMain(size_t workerNo)
+	{
+		size_t generation = 0;
+		threadNo = workerNo;
+
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+
+				while (!stop_ && generation_ == generation) {
+					startCondition_.wait(lock);
+				}
+
+				if (stop_) {
+					return;
+				}
+
+				generation = generation_;
+			}
+
+			runChunks(workerNo);
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				if (--numBusyThreads_ == 0) {
+					doneCondition_.notify_one();
+				}
+			}
+		}
+	}
+}
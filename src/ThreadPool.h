@@ -0,0 +1,208 @@
+/*
+ * ThreadPool.h
+ * RVO2 Library
+ *
+ * Copyright 2008 University of North Carolina at Chapel Hill
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Please send all bug reports to <geom@cs.unc.edu>.
+ *
+ * The authors may be contacted via:
+ *
+ * Jur van den Berg, Stephen J. Guy, Jamie Snape, Ming C. Lin, Dinesh Manocha
+ * Dept. of Computer Science
+ * 201 S. Columbia St.
+ * Frederick P. Brooks, Jr. Computer Science Bldg.
+ * Chapel Hill, N.C. 27599-3175
+ * United States of America
+ *
+ * <http://gamma.cs.unc.edu/RVO2/>
+ */
+
+#ifndef RVO_THREAD_POOL_H_
+#define RVO_THREAD_POOL_H_
+
+/**
+ * \file       ThreadPool.h
+ * \brief      Contains the ThreadPool class.
+ */
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "Definitions.h"
+
+namespace RVO {
+	/**
+	 * \brief      Defines a persistent pool of threads that executes parallel
+	 *             loops over contiguous chunks of items with work stealing.
+	 */
+	class ThreadPool {
+	private:
+		/**
+		 * \brief      Defines the body of a parallel loop.
+		 */
+		class Task {
+		public:
+			/**
+			 * \brief      Destroys this task instance.
+			 */
+			virtual ~Task() { }
+
+			/**
+			 * \brief      Executes the loop body for a range of items.
+			 * \param      begin           The first item of the range.
+			 * \param      end             One past the last item of the range.
+			 */
+			virtual void run(size_t begin, size_t end) = 0;
+		};
+
+		/**
+		 * \brief      Defines a task that calls a member function of an object.
+		 */
+		template <class T, void (T::*Method)(size_t, size_t)>
+		class MemberTask : public Task {
+		public:
+			/**
+			 * \brief      Constructs a member task instance.
+			 * \param      object          The object whose member function is
+			 *                             to be called.
+			 */
+			explicit MemberTask(T *object) : object_(object) { }
+
+			/**
+			 * \brief      Calls the member function for a range of items.
+			 * \param      begin           The first item of the range.
+			 * \param      end             One past the last item of the range.
+			 */
+			virtual void run(size_t begin, size_t end)
+			{
+				(object_->*Method)(begin, end);
+			}
+
+		private:
+			T *object_;
+		};
+
+		/**
+		 * \brief      Defines the chunks of a parallel loop that are queued for
+		 *             a thread.
+		 */
+		class Worker {
+		public:
+			/**
+			 * \brief      The first queued chunk number.
+			 */
+			size_t begin;
+
+			/**
+			 * \brief      One past the last queued chunk number.
+			 */
+			size_t end;
+
+			/**
+			 * \brief      The mutex guarding the queued chunk numbers.
+			 */
+			std::mutex mutex;
+		};
+
+		/**
+		 * \brief      Constructs a thread pool instance and starts its threads.
+		 * \param      numThreads      The number of threads that execute a
+		 *                             parallel loop, including the calling
+		 *                             thread.
+		 */
+		explicit ThreadPool(size_t numThreads);
+
+		/**
+		 * \brief      Stops the threads and destroys this thread pool instance.
+		 */
+		~ThreadPool();
+
+		/**
+		 * \brief      Returns the number of threads that execute a parallel
+		 *             loop, including the calling thread.
+		 * \return     The number of threads.
+		 */
+		size_t getNumThreads() const;
+
+		/**
+		 * \brief      Returns the number of the calling thread within its
+		 *             thread pool.
+		 * \return     The number of the calling thread; zero for threads that
+		 *             do not belong to a thread pool.
+		 */
+		static size_t getThreadNo();
+
+		/**
+		 * \brief      Executes a task for all items in parallel and returns when
+		 *             all items are done. The items are divided into chunks of
+		 *             consecutive items. Each thread starts with a contiguous
+		 *             range of chunks and steals chunks from the end of the
+		 *             ranges of other threads once its own range is exhausted.
+		 * \param      numItems        The number of items.
+		 * \param      chunkSize       The number of items per chunk.
+		 * \param      task            The task to be executed.
+		 */
+		void parallelFor(size_t numItems, size_t chunkSize, Task &task);
+
+		/**
+		 * \brief      Takes the next chunk of the specified thread.
+		 * \param      workerNo        The number of the thread.
+		 * \param      chunk           A reference to the number of the chunk.
+		 * \return     True if a chunk was taken; false otherwise.
+		 */
+		bool popChunk(size_t workerNo, size_t &chunk);
+
+		/**
+		 * \brief      Executes chunks of the current parallel loop on the
+		 *             specified thread until no chunks are left.
+		 * \param      workerNo        The number of the thread.
+		 */
+		void runChunks(size_t workerNo);
+
+		/**
+		 * \brief      Steals the last chunk of another thread.
+		 * \param      workerNo        The number of the stealing thread.
+		 * \param      chunk           A reference to the number of the chunk.
+		 * \return     True if a chunk was stolen; false otherwise.
+		 */
+		bool stealChunk(size_t workerNo, size_t &chunk);
+
+		/**
+		 * \brief      Waits for parallel loops and executes them on the
+		 *             specified thread until the pool is stopped.
+		 * \param      workerNo        The number of the thread.
+		 */
+		void threadMain(size_t workerNo);
+
+		size_t chunkSize_;
+		std::condition_variable doneCondition_;
+		size_t generation_;
+		std::mutex mutex_;
+		size_t numBusyThreads_;
+		size_t numItems_;
+		std::condition_variable startCondition_;
+		bool stop_;
+		Task *task_;
+		std::vector<std::thread> threads_;
+		std::vector<Worker *> workers_;
+
+		friend class KdTree;
+		friend class RVOSimulator;
+	};
+}
+
+#endif /* RVO_THREAD_POOL_H_ */